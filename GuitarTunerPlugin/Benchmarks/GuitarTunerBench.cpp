@@ -0,0 +1,539 @@
+#include <JuceHeader.h>
+#include <benchmark/benchmark.h>
+#include <random>
+#include "GuitarPitchDetectionFX.h"
+#include "BiquadCascade.h"
+#include "RBJCoefficientCache.h"
+#include "RBJFilterBank.h"
+#include "MultiChannelPitchDetectionFX.h"
+
+// Throughput of the pitch detector and the RBJ filters.
+// Results are reported as samples/s and as time per detection so engines can be compared directly.
+
+namespace
+{
+    using Engine = GuitarPitchDetectionFX::DifferenceEngine;
+
+    // A plucked low A with a few harmonics and a little noise, enough to exercise every engine
+    std::vector<float> makeGuitarSignal (int numSamples, float sampleRate, float frequency = 110.0f)
+    {
+        std::vector<float> signal (static_cast<size_t> (numSamples));
+        std::mt19937 rng (1234);
+        std::normal_distribution<float> noise (0.0f, 0.01f);
+
+        for (size_t i = 0; i < signal.size(); ++i)
+        {
+            const float t = static_cast<float> (i) / sampleRate;
+            const float phase = juce::MathConstants<float>::twoPi * frequency * t;
+
+            signal[i] = 0.5f * std::sin (phase) + 0.25f * std::sin (2.0f * phase) + 0.12f * std::sin (3.0f * phase) + noise (rng);
+        }
+
+        return signal;
+    }
+}
+
+// Access to the individual stages of the detector
+class GuitarPitchDetectionFXBench
+{
+public:
+    static void loadFrame (GuitarPitchDetectionFX& fx, const std::vector<float>& signal)
+    {
+        std::copy (signal.begin(), signal.begin() + fx.windowSize * 2, fx.sigBuffer);
+    }
+
+    static void computeDifference (GuitarPitchDetectionFX& fx)    { fx.computeDifference(); }
+    static void computeDifferenceV2 (GuitarPitchDetectionFX& fx)  { fx.computeDifferenceV2(); }
+    static void computeDifferenceFFT (GuitarPitchDetectionFX& fx) { fx.computeDifferenceFFT(); }
+    static float detectPitch (GuitarPitchDetectionFX& fx)         { return fx.detectPitch(); }
+    static float getDifference (GuitarPitchDetectionFX& fx, int tau) { return fx.diffBuffer[static_cast<size_t> (tau)]; }
+
+    static constexpr int frameLength = GuitarPitchDetectionFX::defaultWindowSize * 2;
+};
+
+// ===================== Difference function =====================
+
+template <void (*Compute) (GuitarPitchDetectionFX&)>
+static void BM_Difference (benchmark::State& state)
+{
+    auto fx = std::make_unique<GuitarPitchDetectionFX>();
+    fx->init();
+    GuitarPitchDetectionFXBench::loadFrame (*fx, makeGuitarSignal (GuitarPitchDetectionFXBench::frameLength, 48000.0f));
+
+    for (auto _ : state)
+    {
+        Compute (*fx);
+        benchmark::DoNotOptimize (GuitarPitchDetectionFXBench::getDifference (*fx, 100));
+    }
+
+    state.counters["ns/detection"] = benchmark::Counter (static_cast<double> (state.iterations()) * 1.0e-9,
+                                                         benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK_TEMPLATE (BM_Difference, GuitarPitchDetectionFXBench::computeDifference)->Unit (benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE (BM_Difference, GuitarPitchDetectionFXBench::computeDifferenceV2)->Unit (benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE (BM_Difference, GuitarPitchDetectionFXBench::computeDifferenceFFT)->Unit (benchmark::kMicrosecond);
+
+// ===================== detectPitch =====================
+
+static void BM_DetectPitch (benchmark::State& state)
+{
+    auto fx = std::make_unique<GuitarPitchDetectionFX>();
+    fx->setDifferenceEngine (static_cast<Engine> (state.range (0)));
+    fx->init();
+    GuitarPitchDetectionFXBench::loadFrame (*fx, makeGuitarSignal (GuitarPitchDetectionFXBench::frameLength, 48000.0f));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize (GuitarPitchDetectionFXBench::detectPitch (*fx));
+
+    state.counters["ns/detection"] = benchmark::Counter (static_cast<double> (state.iterations()) * 1.0e-9,
+                                                         benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK (BM_DetectPitch)
+    ->ArgName ("engine")
+    ->Arg (static_cast<int> (Engine::timeDomain))
+    ->Arg (static_cast<int> (Engine::fft))
+    ->Unit (benchmark::kMicrosecond);
+
+// Time domain detection of a low E, an A and a high E with each tau search, the coarse to fine search at both
+// factors. Args - note Hz, tau search, coarse factor
+static void BM_TauSearch (benchmark::State& state)
+{
+    auto fx = std::make_unique<GuitarPitchDetectionFX>();
+    fx->setTauSearch (static_cast<GuitarPitchDetectionFX::TauSearch> (state.range (1)));
+    fx->setCoarseFactor (static_cast<int> (state.range (2)));
+    fx->init();
+    GuitarPitchDetectionFXBench::loadFrame (*fx, makeGuitarSignal (GuitarPitchDetectionFXBench::frameLength, 48000.0f,
+                                                                   static_cast<float> (state.range (0))));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize (GuitarPitchDetectionFXBench::detectPitch (*fx));
+
+    state.counters["ns/detection"] = benchmark::Counter (static_cast<double> (state.iterations()) * 1.0e-9,
+                                                         benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+static void tauSearchArgs (benchmark::internal::Benchmark* benchmark)
+{
+    using TauSearch = GuitarPitchDetectionFX::TauSearch;
+
+    for (const int note : { 82, 110, 330 })
+    {
+        benchmark->Args ({ note, static_cast<int> (TauSearch::full), 4 });
+        benchmark->Args ({ note, static_cast<int> (TauSearch::earlyExit), 4 });
+        benchmark->Args ({ note, static_cast<int> (TauSearch::coarseToFine), 2 });
+        benchmark->Args ({ note, static_cast<int> (TauSearch::coarseToFine), 4 });
+    }
+}
+
+BENCHMARK (BM_TauSearch)
+    ->ArgNames ({ "note", "search", "factor" })
+    ->Apply (tauSearchArgs)
+    ->Unit (benchmark::kMicrosecond);
+
+// ===================== process =====================
+
+// Args - block size, sample rate, difference engine
+static void BM_Process (benchmark::State& state)
+{
+    const auto blockSize = static_cast<int> (state.range (0));
+    const auto sampleRate = static_cast<float> (state.range (1));
+    constexpr int hopSize = 512;
+
+    auto fx = std::make_unique<GuitarPitchDetectionFX>();
+    fx->setSampleRate (sampleRate);
+    fx->setDifferenceEngine (static_cast<Engine> (state.range (2)));
+    fx->setHopSize (hopSize);
+    fx->init();
+
+    const auto signal = makeGuitarSignal (static_cast<int> (sampleRate), sampleRate);
+    std::vector<float> block (static_cast<size_t> (blockSize));
+    size_t readPos = 0;
+
+    for (auto _ : state)
+    {
+        if (readPos + block.size() > signal.size())
+            readPos = 0;
+
+        std::copy (signal.begin() + static_cast<std::ptrdiff_t> (readPos),
+                   signal.begin() + static_cast<std::ptrdiff_t> (readPos + block.size()), block.begin());
+        readPos += block.size();
+
+        fx->process (block.data(), blockSize);
+        benchmark::DoNotOptimize (fx->getPitch());
+    }
+
+    const auto samples = static_cast<double> (state.iterations()) * blockSize;
+    state.counters["samples/s"] = benchmark::Counter (samples, benchmark::Counter::kIsRate);
+    state.counters["ns/detection"] = benchmark::Counter (samples / hopSize * 1.0e-9,
+                                                         benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK (BM_Process)
+    ->ArgNames ({ "block", "rate", "engine" })
+    ->ArgsProduct ({ { 64, 256, 1024 },
+                     { 44100, 48000, 96000, 192000 },
+                     { static_cast<int> (Engine::timeDomain), static_cast<int> (Engine::fft), static_cast<int> (Engine::incremental) } });
+
+// A played note against the -80 dBFS hiss between tuning attempts, with the level gate at sensitivity 0.5.
+// Args - quiet
+static void BM_ProcessGated (benchmark::State& state)
+{
+    constexpr int blockSize = 256;
+    constexpr float sampleRate = 48000.0f;
+    constexpr int hopSize = 512;
+    const bool quiet = state.range (0) != 0;
+
+    auto fx = std::make_unique<GuitarPitchDetectionFX>();
+    fx->setSampleRate (sampleRate);
+    fx->setHopSize (hopSize);
+    fx->setSensitivity (0.5f);
+    fx->init();
+
+    auto signal = makeGuitarSignal (static_cast<int> (sampleRate), sampleRate);
+
+    if (quiet)
+    {
+        std::mt19937 rng (1234);
+        std::normal_distribution<float> noise (0.0f, 1.0e-4f);
+
+        for (auto& sample : signal)
+            sample = noise (rng);
+    }
+
+    std::vector<float> block (static_cast<size_t> (blockSize));
+    size_t readPos = 0;
+
+    for (auto _ : state)
+    {
+        if (readPos + block.size() > signal.size())
+            readPos = 0;
+
+        std::copy (signal.begin() + static_cast<std::ptrdiff_t> (readPos),
+                   signal.begin() + static_cast<std::ptrdiff_t> (readPos + block.size()), block.begin());
+        readPos += block.size();
+
+        fx->process (block.data(), blockSize);
+        benchmark::DoNotOptimize (fx->getPitch());
+    }
+
+    const auto samples = static_cast<double> (state.iterations()) * blockSize;
+    state.counters["samples/s"] = benchmark::Counter (samples, benchmark::Counter::kIsRate);
+    state.counters["skipped"] = static_cast<double> (fx->getSkippedFrameCount()) / (samples / hopSize);
+}
+
+BENCHMARK (BM_ProcessGated)->ArgName ("quiet")->Arg (0)->Arg (1);
+
+// Polyphonic strum analysis on a mono input, args - internal rate (0 for the host rate)
+static void BM_ProcessPolyphonic (benchmark::State& state)
+{
+    constexpr int blockSize = 256;
+    constexpr float sampleRate = 48000.0f;
+    constexpr int hopSize = 1024;
+    constexpr float strings[] = { 82.41f, 110.0f, 146.83f, 196.0f, 246.94f, 329.63f };
+
+    auto fx = std::make_unique<GuitarPitchDetectionFX>();
+    fx->setSampleRate (sampleRate);
+    fx->setInternalSampleRate (static_cast<float> (state.range (0)));
+    fx->setAnalysisMode (GuitarPitchDetectionFX::AnalysisMode::polyphonic);
+    fx->setHopSize (hopSize);
+    fx->init();
+
+    auto signal = makeGuitarSignal (static_cast<int> (sampleRate), sampleRate, strings[0]);
+
+    for (size_t s = 1; s < std::size (strings); ++s)
+    {
+        const auto string = makeGuitarSignal (static_cast<int> (sampleRate), sampleRate, strings[s]);
+
+        for (size_t i = 0; i < signal.size(); ++i)
+            signal[i] += string[i];
+    }
+
+    std::vector<float> block (static_cast<size_t> (blockSize));
+    size_t readPos = 0;
+
+    for (auto _ : state)
+    {
+        if (readPos + block.size() > signal.size())
+            readPos = 0;
+
+        std::copy (signal.begin() + static_cast<std::ptrdiff_t> (readPos),
+                   signal.begin() + static_cast<std::ptrdiff_t> (readPos + block.size()), block.begin());
+        readPos += block.size();
+
+        fx->process (block.data(), blockSize);
+        benchmark::DoNotOptimize (fx->getStringResult (0));
+    }
+
+    const auto decimation = state.range (0) > 0 ? static_cast<int> (sampleRate) / static_cast<int> (state.range (0)) : 1;
+    const auto samples = static_cast<double> (state.iterations()) * blockSize;
+    state.counters["samples/s"] = benchmark::Counter (samples, benchmark::Counter::kIsRate);
+    state.counters["ns/detection"] = benchmark::Counter (samples / (hopSize * decimation) * 1.0e-9,
+                                                         benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK (BM_ProcessPolyphonic)->ArgName ("internal")->Arg (0)->Arg (8000);
+
+// Six strings through one batched detector, compare against six BM_Process instances
+static void BM_MultiChannelProcess (benchmark::State& state)
+{
+    constexpr int numChannels = 6;
+    const auto blockSize = static_cast<int> (state.range (0));
+    constexpr float sampleRate = 48000.0f;
+    constexpr int hopSize = 512;
+
+    auto fx = std::make_unique<MultiChannelPitchDetectionFX>();
+    fx->setSampleRate (sampleRate);
+    fx->setHopSize (hopSize);
+    fx->init();
+
+    const auto signal = makeGuitarSignal (static_cast<int> (sampleRate), sampleRate);
+    const float* channels[numChannels];
+    size_t readPos = 0;
+
+    for (auto _ : state)
+    {
+        if (readPos + static_cast<size_t> (blockSize) > signal.size())
+            readPos = 0;
+
+        for (auto& channel : channels)
+            channel = signal.data() + readPos;
+
+        readPos += static_cast<size_t> (blockSize);
+
+        fx->process (channels, numChannels, blockSize);
+        benchmark::DoNotOptimize (fx->getPitch (0));
+    }
+
+    const auto samples = static_cast<double> (state.iterations()) * blockSize;
+    state.counters["samples/s"] = benchmark::Counter (samples * numChannels, benchmark::Counter::kIsRate);
+    state.counters["ns/detection"] = benchmark::Counter (samples / hopSize * numChannels * 1.0e-9,
+                                                         benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK (BM_MultiChannelProcess)->ArgName ("block")->Arg (64)->Arg (256)->Arg (1024);
+
+// ===================== RBJ filters =====================
+
+template <typename Filter>
+static void BM_FilterPerSample (benchmark::State& state)
+{
+    const auto blockSize = static_cast<int> (state.range (0));
+    const auto signal = makeGuitarSignal (blockSize, 48000.0f);
+    std::vector<float> block (signal);
+
+    Filter filter;
+    filter.calculateCoeffs (1000.0f, 48000.0f, 2);
+    RBJFilter_base& base = filter;
+
+    for (auto _ : state)
+    {
+        std::copy (signal.begin(), signal.end(), block.begin());
+
+        for (auto& sample : block)
+            base.process (sample);
+
+        benchmark::DoNotOptimize (block.data());
+    }
+
+    state.counters["samples/s"] = benchmark::Counter (static_cast<double> (state.iterations()) * blockSize, benchmark::Counter::kIsRate);
+}
+
+template <typename Filter>
+static void BM_FilterBlock (benchmark::State& state)
+{
+    const auto blockSize = static_cast<int> (state.range (0));
+    const auto signal = makeGuitarSignal (blockSize, 48000.0f);
+    std::vector<float> block (signal.size());
+
+    Filter filter;
+    filter.calculateCoeffs (1000.0f, 48000.0f, 2);
+
+    for (auto _ : state)
+    {
+        filter.process (signal.data(), block.data(), blockSize);
+        benchmark::DoNotOptimize (block.data());
+    }
+
+    state.counters["samples/s"] = benchmark::Counter (static_cast<double> (state.iterations()) * blockSize, benchmark::Counter::kIsRate);
+}
+
+#define GUITAR_TUNER_FILTER_BENCHMARKS(Filter) \
+    BENCHMARK_TEMPLATE (BM_FilterPerSample, Filter)->Arg (64)->Arg (512); \
+    BENCHMARK_TEMPLATE (BM_FilterBlock, Filter)->Arg (64)->Arg (512);
+
+GUITAR_TUNER_FILTER_BENCHMARKS (LPF)
+GUITAR_TUNER_FILTER_BENCHMARKS (HPF)
+GUITAR_TUNER_FILTER_BENCHMARKS (Peak)
+GUITAR_TUNER_FILTER_BENCHMARKS (BPF)
+GUITAR_TUNER_FILTER_BENCHMARKS (BPFcQ)
+GUITAR_TUNER_FILTER_BENCHMARKS (Notch)
+GUITAR_TUNER_FILTER_BENCHMARKS (APF)
+GUITAR_TUNER_FILTER_BENCHMARKS (LowShelf)
+GUITAR_TUNER_FILTER_BENCHMARKS (HighShelf)
+
+static void BM_BandLimitCascade (benchmark::State& state)
+{
+    const auto blockSize = static_cast<int> (state.range (0));
+    const auto signal = makeGuitarSignal (blockSize, 48000.0f);
+    std::vector<float> block (signal.size());
+
+    BiquadCascade<LPF, LPF, HPF, HPF> cascade;
+    cascade.calculateCoeffs<0> (1000.0f, 48000.0f, 2);
+    cascade.calculateCoeffs<1> (1000.0f, 48000.0f, 2);
+    cascade.calculateCoeffs<2> (60.0f, 48000.0f, 2);
+    cascade.calculateCoeffs<3> (60.0f, 48000.0f, 2);
+
+    for (auto _ : state)
+    {
+        cascade.process (signal.data(), block.data(), blockSize);
+        benchmark::DoNotOptimize (block.data());
+    }
+
+    state.counters["samples/s"] = benchmark::Counter (static_cast<double> (state.iterations()) * blockSize, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK (BM_BandLimitCascade)->Arg (64)->Arg (512);
+
+// Eight LPFs run as separate filters or as the lanes of one bank, interleaved samples either way.
+// Args - block size, bank
+static void BM_FilterBank (benchmark::State& state)
+{
+    constexpr int numLanes = 8;
+    const auto blockSize = static_cast<int> (state.range (0));
+    const bool banked = state.range (1) != 0;
+    const auto signal = makeGuitarSignal (blockSize * numLanes, 48000.0f);
+    std::vector<float> block (signal.size());
+    std::vector<float> lane (static_cast<size_t> (blockSize));
+
+    std::array<LPF, numLanes> filters;
+    RBJFilterBank<numLanes> bank;
+
+    for (int l = 0; l < numLanes; ++l)
+    {
+        filters[static_cast<size_t> (l)].calculateCoeffs (200.0f * static_cast<float> (l + 1), 48000.0f, 2);
+        bank.setCoeffs (l, 0, filters[static_cast<size_t> (l)]);
+    }
+
+    for (auto _ : state)
+    {
+        if (banked)
+        {
+            bank.process (signal.data(), block.data(), blockSize);
+        }
+        else
+        {
+            for (size_t l = 0; l < numLanes; ++l)
+            {
+                for (size_t i = 0; i < lane.size(); ++i)
+                    lane[i] = signal[i * numLanes + l];
+
+                filters[l].process (lane.data(), blockSize);
+
+                for (size_t i = 0; i < lane.size(); ++i)
+                    block[i * numLanes + l] = lane[i];
+            }
+        }
+
+        benchmark::DoNotOptimize (block.data());
+    }
+
+    state.counters["samples/s"] = benchmark::Counter (static_cast<double> (state.iterations()) * blockSize * numLanes, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK (BM_FilterBank)->ArgNames ({ "block", "bank" })->ArgsProduct ({ { 64, 512 }, { 0, 1 } });
+
+// Retunes the band around a note that moves every block, either recomputing the coefficients or
+// interpolating them from the caches and ramping over the block. Args - block size, cached
+static void BM_BandLimitRetune (benchmark::State& state)
+{
+    const auto blockSize = static_cast<int> (state.range (0));
+    const bool cached = state.range (1) != 0;
+    const auto signal = makeGuitarSignal (blockSize, 48000.0f);
+    std::vector<float> block (signal.size());
+
+    BiquadCascade<LPF, LPF, HPF, HPF> cascade;
+    RBJCoefficientCache<LPF> lowPassCache;
+    RBJCoefficientCache<HPF> highPassCache;
+    lowPassCache.prepare (48000.0f, 2);
+    highPassCache.prepare (48000.0f, 2);
+
+    float note = 110.0f;
+
+    for (auto _ : state)
+    {
+        note = note > 330.0f ? 110.0f : note * 1.01f;
+
+        if (cached)
+        {
+            cascade.setCoeffs<0> (lowPassCache.get (note * 4.0f), blockSize);
+            cascade.setCoeffs<1> (lowPassCache.get (note * 4.0f), blockSize);
+            cascade.setCoeffs<2> (highPassCache.get (note * 0.5f), blockSize);
+            cascade.setCoeffs<3> (highPassCache.get (note * 0.5f), blockSize);
+        }
+        else
+        {
+            cascade.calculateCoeffs<0> (note * 4.0f, 48000.0f, 2);
+            cascade.calculateCoeffs<1> (note * 4.0f, 48000.0f, 2);
+            cascade.calculateCoeffs<2> (note * 0.5f, 48000.0f, 2);
+            cascade.calculateCoeffs<3> (note * 0.5f, 48000.0f, 2);
+        }
+
+        cascade.process (signal.data(), block.data(), blockSize);
+        benchmark::DoNotOptimize (block.data());
+    }
+
+    state.counters["samples/s"] = benchmark::Counter (static_cast<double> (state.iterations()) * blockSize, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK (BM_BandLimitRetune)->ArgNames ({ "block", "cached" })->ArgsProduct ({ { 64, 512 }, { 0, 1 } });
+
+// Two 60 Hz HPF stages at 192 kHz, poles close to 1 where the recursion lives on its state, on a guitar signal or on
+// the tail of one impulse that decays through the denormal range. Cost should not depend on the input.
+// Args - double precision, silent tail
+template <typename SampleType>
+static void runLowFrequencyHighPass (benchmark::State& state, bool silentTail)
+{
+    constexpr int blockSize = 512;
+    constexpr float fs = 192000.0f;
+    auto signal = makeGuitarSignal (blockSize, fs);
+
+    if (silentTail)
+        std::fill (signal.begin(), signal.end(), 0.0f);
+
+    std::vector<float> block (signal.size());
+
+    BiquadCascade<RBJ::HPF<SampleType>, RBJ::HPF<SampleType>> cascade;
+    cascade.template calculateCoeffs<0> (60.0f, fs, 2);
+    cascade.template calculateCoeffs<1> (60.0f, fs, 2);
+
+    if (silentTail)
+    {
+        std::vector<float> impulse (static_cast<size_t> (blockSize), 0.0f);
+        impulse[0] = 1.0f;
+        cascade.process (impulse.data(), block.data(), blockSize);
+    }
+
+    for (auto _ : state)
+    {
+        cascade.process (signal.data(), block.data(), blockSize);
+        benchmark::DoNotOptimize (block.data());
+    }
+
+    state.counters["samples/s"] = benchmark::Counter (static_cast<double> (state.iterations()) * blockSize, benchmark::Counter::kIsRate);
+}
+
+static void BM_LowFrequencyHighPass (benchmark::State& state)
+{
+    const bool silentTail = state.range (1) != 0;
+
+    if (state.range (0) != 0)
+        runLowFrequencyHighPass<double> (state, silentTail);
+    else
+        runLowFrequencyHighPass<float> (state, silentTail);
+}
+
+BENCHMARK (BM_LowFrequencyHighPass)->ArgNames ({ "double", "silent" })->ArgsProduct ({ { 0, 1 }, { 0, 1 } });
+
+BENCHMARK_MAIN();
@@ -0,0 +1,152 @@
+#pragma once
+#include <tuple>
+#include <type_traits>
+#include "RBJFilters.h"
+#include "RBJCoefficientCache.h"
+
+// Chain of RBJ biquads where the filter type of each stage is fixed at compile time.
+// The stage types only pick the coefficient formula, coefficients and state for every stage live in
+// one cache aligned struct and are run in a single loop so the compiler can inline and fuse the stages.
+// Each stage is a transposed direct form II biquad with two state variables, held in the stages' SampleType while
+// the audio in and out stays float. Blocks run with flush to zero set and snap the state to zero at the end.
+// Stages can be moved to new coefficients over a ramp that steps every rampInterval samples, close enough to
+// continuous not to zipper while the sample loop itself stays the same as for fixed coefficients.
+
+template <typename... Stages>
+class BiquadCascade
+{
+public:
+    static constexpr size_t numStages = sizeof... (Stages);
+    static_assert (numStages > 0, "a cascade needs at least one stage");
+
+    static constexpr int rampInterval = 16;
+
+    template <size_t Index>
+    using StageType = std::tuple_element_t<Index, std::tuple<Stages...>>;
+
+    using SampleType = typename StageType<0>::ValueType;
+    static_assert ((std::is_same_v<typename Stages::ValueType, SampleType> && ...), "every stage needs the same sample type");
+
+    BiquadCascade() { reset(); }
+
+    // Switches immediately, computes the coefficients so keep it off the audio thread
+    template <size_t Index>
+    void calculateCoeffs (float fc, float fs, int order)
+    {
+        StageType<Index> filter;
+        filter.calculateCoeffs (fc, fs, order);
+
+        setCoeffs<Index> (RBJ::Coefficients<SampleType>::fromFilter (filter));
+    }
+
+    // Moves a stage linearly to target over roughly rampSamples samples, 0 switches immediately. Safe on the audio
+    // thread, a ramp still in progress carries on from wherever it has got to.
+    template <size_t Index>
+    void setCoeffs (const RBJ::Coefficients<SampleType>& target, int rampSamples = 0) noexcept
+    {
+        const SampleType values[NUMCOEFFS] = { target.b0, target.b1, target.b2, target.a1, target.a2 };
+        const int numSteps = juce::jmax (0, (rampSamples + rampInterval - 1) / rampInterval);
+
+        for (size_t c = 0; c < NUMCOEFFS; ++c)
+        {
+            data.targets[Index][c] = values[c];
+
+            if (numSteps > 0)
+                data.steps[Index][c] = (values[c] - data.coeffs[Index][c]) / static_cast<SampleType> (numSteps);
+            else
+                data.coeffs[Index][c] = values[c];
+        }
+
+        data.rampSteps[Index] = numSteps;
+    }
+
+    void reset() noexcept
+    {
+        memset (&data, 0, sizeof (data));
+    }
+
+    void process (const float* input, float* output, int numSamples) noexcept
+    {
+        juce::ScopedNoDenormals noDenormals;
+        Data local = data;
+
+        for (int start = 0; start < numSamples;)
+        {
+            const bool ramping = stepRamps (local);
+            const int end = ramping ? juce::jmin (numSamples, start + rampInterval) : numSamples;
+
+            run (local, input, output, start, end);
+            start = end;
+        }
+
+        for (auto& stage : local.state)
+            for (auto& value : stage)
+                value = RBJ::snapToZero (value);
+
+        data = local;
+    }
+
+    void process (float* inputOutput, int numSamples) noexcept
+    {
+        process (inputOutput, inputOutput, numSamples);
+    }
+
+private:
+    enum coeffs { b0, b1, b2, a1, a2, NUMCOEFFS };
+    enum state { s1, s2, NUMSTATE };
+
+    struct alignas (64) Data
+    {
+        SampleType coeffs[numStages][NUMCOEFFS];
+        SampleType state[numStages][NUMSTATE];
+        SampleType targets[numStages][NUMCOEFFS];
+        SampleType steps[numStages][NUMCOEFFS];
+        int rampSteps[numStages];
+    };
+
+    // Advances every stage that is ramping by one step, the last step lands exactly on the target
+    static bool stepRamps (Data& local) noexcept
+    {
+        bool ramping = false;
+
+        for (size_t s = 0; s < numStages; ++s)
+        {
+            if (local.rampSteps[s] == 0)
+                continue;
+
+            const bool last = --local.rampSteps[s] == 0;
+
+            for (size_t k = 0; k < NUMCOEFFS; ++k)
+                local.coeffs[s][k] = last ? local.targets[s][k] : local.coeffs[s][k] + local.steps[s][k];
+
+            ramping = true;
+        }
+
+        return ramping;
+    }
+
+    static void run (Data& local, const float* input, float* output, int begin, int end) noexcept
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            SampleType sample = input[i];
+
+            for (size_t s = 0; s < numStages; ++s)
+            {
+                const SampleType* c = local.coeffs[s];
+                SampleType* st = local.state[s];
+
+                const SampleType out = c[b0] * sample + st[s1];
+
+                st[s1] = (c[b1] * sample + st[s2]) - c[a1] * out;
+                st[s2] = c[b2] * sample - c[a2] * out;
+
+                sample = out;
+            }
+
+            output[i] = static_cast<float> (sample);
+        }
+    }
+
+    Data data;
+};
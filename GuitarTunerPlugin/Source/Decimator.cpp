@@ -0,0 +1,65 @@
+#include "Decimator.h"
+#include "VectorOps.h"
+
+void Decimator::prepare (int decimationFactor, int tapsPerPhase)
+{
+    factor = juce::jmax (1, decimationFactor);
+    numTaps = factor * juce::jmax (1, tapsPerPhase);
+
+    taps.assign (static_cast<size_t> (numTaps), 0.0f);
+    history.assign (static_cast<size_t> (numTaps * 2), 0.0f);
+
+    // Blackman windowed sinc with the cutoff a little under the output nyquist
+    const double cutoff = 0.8 * 0.5 / static_cast<double> (factor);
+    const double centre = 0.5 * static_cast<double> (numTaps - 1);
+    double gain = 0.0;
+
+    for (int i = 0; i < numTaps; ++i)
+    {
+        const double t = static_cast<double> (i) - centre;
+        const double sinc = t == 0.0 ? 2.0 * cutoff
+                                     : std::sin (2.0 * juce::MathConstants<double>::pi * cutoff * t) / (juce::MathConstants<double>::pi * t);
+        const double phaseAngle = 2.0 * juce::MathConstants<double>::pi * static_cast<double> (i) / static_cast<double> (numTaps - 1);
+        const double window = numTaps > 1 ? 0.42 - 0.5 * std::cos (phaseAngle) + 0.08 * std::cos (2.0 * phaseAngle) : 1.0;
+
+        taps[static_cast<size_t> (i)] = static_cast<float> (sinc * window);
+        gain += sinc * window;
+    }
+
+    for (auto& tap : taps)
+        tap = static_cast<float> (tap / gain);
+
+    reset();
+}
+
+void Decimator::reset()
+{
+    std::fill (history.begin(), history.end(), 0.0f);
+    writePos = 0;
+    phase = 0;
+}
+
+// The taps are symmetric so they can be applied to the history oldest first
+int Decimator::process (const float* input, float* output, int numSamples) noexcept
+{
+    int numOut = 0;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float sample = input[i];
+        history[static_cast<size_t> (writePos)] = sample;
+        history[static_cast<size_t> (writePos + numTaps)] = sample;
+
+        if (++writePos == numTaps)
+            writePos = 0;
+
+        if (++phase == factor)
+        {
+            phase = 0;
+            VectorOps::dotProduct (&taps[0], &history[static_cast<size_t> (writePos)], &output[numOut], numTaps);
+            ++numOut;
+        }
+    }
+
+    return numOut;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Polyphase FIR decimator - the anti-alias filter output is only computed for the samples that are kept,
+// so the cost is tapsPerPhase multiply-adds per input sample whatever the factor.
+
+class Decimator
+{
+public:
+    Decimator() = default;
+    ~Decimator() = default;
+
+    // allocates, call from init and not from the audio thread
+    void prepare (int decimationFactor, int tapsPerPhase = 8);
+    void reset();
+
+    // Safe to run in place, returns the number of samples written to output
+    int process (const float* input, float* output, int numSamples) noexcept;
+
+    int getFactor() const noexcept { return factor; }
+
+private:
+    int factor = 1;
+    int numTaps = 0;
+    int writePos = 0;
+    int phase = 0;
+
+    std::vector<float> taps;
+
+    // mirrored so the last numTaps samples are always contiguous from writePos
+    std::vector<float> history;
+};
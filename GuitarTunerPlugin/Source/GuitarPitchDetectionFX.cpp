@@ -1,59 +1,532 @@
 #include "GuitarPitchDetectionFX.h"
 #include "VectorOps.h"
+#include "YinSearch.h"
 
-void GuitarPitchDetectionFX::init()
+GuitarPitchDetectionFX::~GuitarPitchDetectionFX()
 {
+    analysisThread.reset();
+}
+
+void GuitarPitchDetectionFX::init (int windowLength)
+{
+    if (analysisThread != nullptr)
+        analysisThread->stopThread (1000);
+
+    activeThreadingMode = threadingMode;
+    activeAnalysisMode = analysisMode;
+    activeDifferenceEngine = differenceEngine;
+    activeTauSearch = tauSearch;
+    activeBandLimitFilter = bandLimitFilter;
+
+    const int factor = internalSampleRate > 0.0f ? juce::jmax (1, static_cast<int> (sampleRate / internalSampleRate)) : 1;
+    decimator.prepare (factor);
+    analysisRate = sampleRate / static_cast<float> (factor);
+
+    updateLagRange (windowLength);
+    spectrumLength = activeAnalysisMode == AnalysisMode::polyphonic ? getSpectrumLength (analysisRate) : 0;
+    allocateBuffers();
     clearBuffers();
-    lpf1.calculateCoeffs (1000.0f, sampleRate, 2);
-    lpf2.calculateCoeffs (1000.0f, sampleRate, 2);
-    hpf1.calculateCoeffs (60.0f, sampleRate, 2);
-    hpf2.calculateCoeffs (60.0f, sampleRate, 2);
+
+    // smallest fft that holds the spectrum frame in polyphonic mode and the 2 * W samples of a frame otherwise,
+    // the arena is sized for the same one
+    const int fftSize = static_cast<int> (getArenaLayout (windowSize, false, spectrumLength).fftSize);
+    int order = 1;
+
+    while ((1 << order) < fftSize)
+        ++order;
+
+    if (fft == nullptr || fft->getSize() != fftSize)
+        fft = std::make_unique<juce::dsp::FFT> (order);
+
+    for (int i = 0; i < spectrumLength; ++i)
+        spectrumWindow[static_cast<size_t> (i)] = 0.5f - 0.5f * std::cos (juce::MathConstants<float>::twoPi * static_cast<float> (i) / static_cast<float> (spectrumLength - 1));
+
+    for (auto& stringPitch : stringPitches)
+        stringPitch.store (-1.0f, std::memory_order_relaxed);
+
+    // exact coefficients for the starting band, the caches are only for retuning while running
+    lowPassCache.prepare (sampleRate, bandLimitOrder);
+    highPassCache.prepare (sampleRate, bandLimitOrder);
+    appliedBandLow = bandLowHz.load (std::memory_order_relaxed);
+    appliedBandHigh = bandHighHz.load (std::memory_order_relaxed);
+
+    RBJ::LPF<double> lowPass;
+    RBJ::HPF<double> highPass;
+    lowPass.calculateCoeffs (appliedBandHigh, sampleRate, bandLimitOrder);
+    highPass.calculateCoeffs (appliedBandLow, sampleRate, bandLimitOrder);
+
+    bandLimit.reset();
+    singleBandLimit.reset();
+    bandLimitBank.reset();
+    setBandLimitCoeffs (RBJ::Coefficients<double>::fromFilter (lowPass), RBJ::Coefficients<double>::fromFilter (highPass), 0);
+
+    inputFifo.reset();
+    resultFifo.reset();
+    latestResult.store (PitchResult {});
+    frameCount = 0;
+    frameRms = 0.0f;
+    amortisedFramePending = false;
+    gateOpen = false;
+    skippedFrames.store (0, std::memory_order_relaxed);
+
+    if (activeThreadingMode == ThreadingMode::analysisThread)
+    {
+        if (analysisThread == nullptr)
+            analysisThread = std::make_unique<AnalysisThread> (*this);
+
+        analysisThread->startThread();
+    }
+}
+
+// A guitar only needs roughly 60 Hz - 1.3 kHz, the guard band keeps about a semitone either side
+// so a string that is well out of tune is still inside the search range
+void GuitarPitchDetectionFX::updateLagRange (int windowLength)
+{
+    constexpr float guardRatio = 1.06f;
+    constexpr int guardSamples = 2;
+    static_assert (windowGranularity % VectorOps::squaredDistanceLagCount == 0);
+
+    windowSize = defaultWindowSize;
+    minTau = 0;
+
+    if (windowLength > 0)
+        windowSize = juce::jlimit (windowGranularity, maxWindowSize, roundWindowSize (windowLength));
+    else if (minFrequency > 0.0f)
+    {
+        const int longestPeriod = static_cast<int> (std::ceil (analysisRate * guardRatio / minFrequency)) + guardSamples;
+        windowSize = juce::jlimit (windowGranularity, maxWindowSize, roundWindowSize (longestPeriod));
+    }
+
+    if (maxFrequency > 0.0f)
+    {
+        const int shortestPeriod = static_cast<int> (std::floor (analysisRate / (maxFrequency * guardRatio))) - guardSamples;
+        minTau = juce::jlimit (0, windowSize - 1, shortestPeriod);
+    }
+
+    // 0 when the shortest period is too short for the coarse to fine search at any factor
+    const float periodLimit = maxFrequency > 0.0f ? analysisRate / (maxFrequency * minCoarsePeriod) : static_cast<float> (coarseFactor);
+    coarseStep = coarseFactor;
+
+    while (coarseStep >= 2 && static_cast<float> (coarseStep) > periodLimit)
+        coarseStep /= 2;
+
+    coarseStep = coarseStep >= 2 ? coarseStep : 0;
+}
+
+// Off the audio thread from init(), the heap arena is only replaced when the window needs a different size
+void GuitarPitchDetectionFX::allocateBuffers()
+{
+    const auto layout = getArenaLayout (windowSize, activeThreadingMode == ThreadingMode::analysisThread, spectrumLength);
+    std::byte* arena = externalArena;
+
+    if (arena == nullptr || layout.total > externalArenaSize)
+    {
+        if (ownedArena == nullptr || ownedArenaSize != layout.total)
+        {
+            ownedArena = std::make_unique<std::byte[]> (layout.total + arenaAlignment - 1);
+            ownedArenaSize = layout.total;
+        }
+
+        const auto address = reinterpret_cast<std::uintptr_t> (ownedArena.get());
+        arena = ownedArena.get() + ((arenaAlignment - address % arenaAlignment) % arenaAlignment);
+    }
+
+    const auto floatsAt = [arena] (size_t offset) { return reinterpret_cast<float*> (arena + offset); };
+
+    ringBuffer = floatsAt (layout.ring);
+    sigBuffer = floatsAt (layout.signal);
+    diffBuffer = floatsAt (layout.difference);
+    cumulativeBuffer = floatsAt (layout.cumulative);
+    fftSignal = floatsAt (layout.fftSignal);
+    fftWindow = floatsAt (layout.fftWindow);
+    spectrumWindow = floatsAt (layout.spectrumWindow);
+    runningDiff = reinterpret_cast<double*> (arena + layout.runningDiff);
+    coarseSignal = floatsAt (layout.coarseSignal);
+    coarseDiffBuffer = floatsAt (layout.coarseDifference);
+    coarseSumBuffer = floatsAt (layout.coarseSum);
+    inputQueue = layout.inputQueue > 0 ? floatsAt (layout.inputQueue) : nullptr;
+    ringSize = static_cast<int> (layout.ringSize);
 }
 
 void GuitarPitchDetectionFX::update()
 {
+    const float low = bandLowHz.load (std::memory_order_relaxed);
+    const float high = bandHighHz.load (std::memory_order_relaxed);
+
+    if (low == appliedBandLow && high == appliedBandHigh)
+        return;
+
+    appliedBandLow = low;
+    appliedBandHigh = high;
+
+    const auto lowPass = lowPassCache.get (high);
+    const auto highPass = highPassCache.get (low);
+
+    setBandLimitCoeffs (lowPass, highPass, bandLimitRampSamples);
+}
+
+// The single precision cascade gets the double coefficients rounded, the filter bank has no ramps and switches at once
+void GuitarPitchDetectionFX::setBandLimitCoeffs (const RBJ::Coefficients<double>& lowPass, const RBJ::Coefficients<double>& highPass, int rampSamples) noexcept
+{
+    if (activeBandLimitFilter == BandLimitFilter::singlePrecision)
+    {
+        const auto toSingle = [] (const RBJ::Coefficients<double>& c) -> RBJ::Coefficients<float>
+        {
+            return { static_cast<float> (c.b0), static_cast<float> (c.b1), static_cast<float> (c.b2),
+                     static_cast<float> (c.a1), static_cast<float> (c.a2) };
+        };
+
+        singleBandLimit.setCoeffs<0> (toSingle (lowPass), rampSamples);
+        singleBandLimit.setCoeffs<1> (toSingle (lowPass), rampSamples);
+        singleBandLimit.setCoeffs<2> (toSingle (highPass), rampSamples);
+        singleBandLimit.setCoeffs<3> (toSingle (highPass), rampSamples);
+    }
+    else if (activeBandLimitFilter == BandLimitFilter::filterBank)
+    {
+        bandLimitBank.setCoeffs (0, 0, lowPass);
+        bandLimitBank.setCoeffs (0, 1, lowPass);
+        bandLimitBank.setCoeffs (0, 2, highPass);
+        bandLimitBank.setCoeffs (0, 3, highPass);
+    }
+    else
+    {
+        bandLimit.setCoeffs<0> (lowPass, rampSamples);
+        bandLimit.setCoeffs<1> (lowPass, rampSamples);
+        bandLimit.setCoeffs<2> (highPass, rampSamples);
+        bandLimit.setCoeffs<3> (highPass, rampSamples);
+    }
+}
+
+void GuitarPitchDetectionFX::processBandLimit (const float* input, float* output, int numSamples) noexcept
+{
+    if (activeBandLimitFilter == BandLimitFilter::singlePrecision)
+        singleBandLimit.process (input, output, numSamples);
+    else if (activeBandLimitFilter == BandLimitFilter::filterBank)
+        bandLimitBank.process (input, output, numSamples);
+    else
+        bandLimit.process (input, output, numSamples);
+}
 
+void GuitarPitchDetectionFX::setBandLimit (float lowHz, float highHz) noexcept
+{
+    bandLowHz.store (lowHz, std::memory_order_relaxed);
+    bandHighHz.store (highHz, std::memory_order_relaxed);
+}
+
+void GuitarPitchDetectionFX::setSensitivity (float level) noexcept
+{
+    const float thresholdDb = gateFloorDb + juce::jlimit (0.0f, 1.0f, level) * gateRangeDb;
+    gateOpenLevel.store (juce::Decibels::decibelsToGain (thresholdDb), std::memory_order_relaxed);
+}
+
+void GuitarPitchDetectionFX::setTargetNotes (const std::array<float, numStrings>& frequencies) noexcept
+{
+    for (size_t i = 0; i < frequencies.size(); ++i)
+        targetNotes[i].store (frequencies[i], std::memory_order_relaxed);
+}
+
+GuitarPitchDetectionFX::StringResult GuitarPitchDetectionFX::getStringResult (int string) const noexcept
+{
+    const auto index = static_cast<size_t> (juce::jlimit (0, numStrings - 1, string));
+    StringResult result;
+    result.pitch = stringPitches[index].load (std::memory_order_acquire);
+
+    if (result.pitch > 0.0f)
+        result.cents = 1200.0f * std::log2 (result.pitch / targetNotes[index].load (std::memory_order_relaxed));
+
+    return result;
 }
 
 void GuitarPitchDetectionFX::process (float* audioStream, int numSamples)
 {
-    for (int i = 0; i < numSamples; ++i)
+    if (activeThreadingMode == ThreadingMode::analysisThread)
+    {
+        queueSamples (audioStream, numSamples);
+        return;
+    }
+
+    analyseSamples (audioStream, numSamples);
+
+    if (activeThreadingMode == ThreadingMode::amortised)
+        continueAmortisedFrame();
+}
+
+// Audio thread side of the analysis thread, a copy into the lock-free queue and nothing else
+void GuitarPitchDetectionFX::queueSamples (const float* samples, int numSamples) noexcept
+{
+    int start1, size1, start2, size2;
+    inputFifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        juce::FloatVectorOperations::copy (&inputQueue[static_cast<size_t> (start1)], samples, size1);
+
+    if (size2 > 0)
+        juce::FloatVectorOperations::copy (&inputQueue[static_cast<size_t> (start2)], samples + size1, size2);
+
+    inputFifo.finishedWrite (size1 + size2);
+
+    if (size1 + size2 < numSamples)
+        droppedSamples.fetch_add (static_cast<juce::uint64> (numSamples - size1 - size2), std::memory_order_relaxed);
+}
+
+bool GuitarPitchDetectionFX::analyseQueuedSamples()
+{
+    int start1, size1, start2, size2;
+    inputFifo.prepareToRead (maxBlockSize, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+        return false;
+
+    analyseSamples (&inputQueue[static_cast<size_t> (start1)], size1);
+
+    if (size2 > 0)
+        analyseSamples (&inputQueue[static_cast<size_t> (start2)], size2);
+
+    inputFifo.finishedRead (size1 + size2);
+    return true;
+}
+
+// Polls rather than being signalled so the audio thread never touches a lock
+void GuitarPitchDetectionFX::AnalysisThread::run()
+{
+    while (! threadShouldExit())
     {
-        float sample = audioStream[i];
-        lpf1.process (sample);
-        lpf2.process (sample);
+        if (! owner.analyseQueuedSamples())
+            wait (1);
+    }
+}
 
-        hpf1.process (sample);
-        hpf2.process (sample);
+void GuitarPitchDetectionFX::analyseSamples (const float* samples, int numSamples)
+{
+    update();
 
-        sigBuffer[bufferSampleCnt] = sample;
-        bufferSampleCnt++;
+    for (int start = 0; start < numSamples; start += maxBlockSize)
+    {
+        const int blockSize = juce::jmin (maxBlockSize, numSamples - start);
 
-        if (bufferSampleCnt >= halfBufferSize)
+        processBandLimit (samples + start, &filterBuffer[0], blockSize);
+
+        // the band limit has already removed most of what the decimator would fold down, it only cleans up what is left
+        const int numAnalysisSamples = decimator.getFactor() > 1 ? decimator.process (&filterBuffer[0], &filterBuffer[0], blockSize)
+                                                                 : blockSize;
+
+        for (int i = 0; i < numAnalysisSamples; ++i)
         {
-            pitch.store (detectPitch(), std::memory_order::memory_order_release);
-            clearBuffers();
-            bufferSampleCnt = 0;
+            const float sample = filterBuffer[static_cast<size_t> (i)];
+            hopSumOfSquares += sample * sample;
+            hopPeak = juce::jmax (hopPeak, std::abs (sample));
+
+            ringBuffer[ringWritePos] = sample;
+            ringWritePos = (ringWritePos + 1) & static_cast<size_t> (ringSize - 1);
+            ++analysedSampleCount;
+
+            if (++samplesSinceLastFrame >= hopSize)
+            {
+                if (! updateGate())
+                    skipFrame();
+                else if (activeThreadingMode == ThreadingMode::amortised && activeAnalysisMode == AnalysisMode::monophonic)
+                    beginAmortisedFrame();
+                else
+                    analyseFrame();
+
+                samplesSinceLastFrame = 0;
+            }
         }
     }
 }
 
 void GuitarPitchDetectionFX::clearBuffers()
 {
-    memset (&diffBuffer[0], 0, sizeof (float) * bufferSize);
-    memset (&sigBuffer[0], 0, sizeof (float) * bufferSize);
-    memset (&cumulativeBuffer[0], 0, sizeof (float) * bufferSize);
+    juce::FloatVectorOperations::clear (ringBuffer, ringSize);
+    juce::FloatVectorOperations::clear (sigBuffer, windowSize * 2);
+    juce::FloatVectorOperations::clear (diffBuffer, windowSize);
+    juce::FloatVectorOperations::clear (cumulativeBuffer, windowSize);
+
+    ringWritePos = 0;
+    samplesSinceLastFrame = 0;
+    hopSumOfSquares = 0.0f;
+    hopPeak = 0.0f;
+    hopLevel = 0.0f;
+    analysedSampleCount = 0;
+    frameEndSample = 0;
+    runningDiffValid = false;
+}
+
+// Unwraps the ring so sigBuffer starts with the last 2 * W samples, oldest first
+void GuitarPitchDetectionFX::copyRingToSignalBuffer()
+{
+    const int frameLength = windowSize * 2;
+    const auto oldest = (ringWritePos + static_cast<size_t> (ringSize - frameLength)) & static_cast<size_t> (ringSize - 1);
+    const int tail = juce::jmin (frameLength, ringSize - static_cast<int> (oldest));
+
+    juce::FloatVectorOperations::copy (&sigBuffer[0], &ringBuffer[oldest], tail);
+    juce::FloatVectorOperations::copy (&sigBuffer[static_cast<size_t> (tail)], &ringBuffer[0], frameLength - tail);
+    frameEndSample = analysedSampleCount;
+
+    float sumOfSquares = 0.0f;
+    VectorOps::sumOfSquares (&sigBuffer[0], &sumOfSquares, frameLength);
+    frameRms = std::sqrt (sumOfSquares / static_cast<float> (frameLength));
+}
+
+void GuitarPitchDetectionFX::analyseFrame()
+{
+    if (activeAnalysisMode == AnalysisMode::polyphonic)
+    {
+        runningDiffValid = false;
+        publishResult (detectStrings());
+        return;
+    }
+
+    if (activeDifferenceEngine == DifferenceEngine::incremental)
+        prepareIncrementalFrame (samplesSinceLastFrame);
+
+    copyRingToSignalBuffer();
+    publishResult (detectPitch());
+}
+
+// sigBuffer is only refilled when no frame is in progress, the ring keeps collecting in the meantime
+void GuitarPitchDetectionFX::beginAmortisedFrame()
+{
+    if (amortisedFramePending)
+        return;
+
+    copyRingToSignalBuffer();
+    runningDiffValid = false;
+    amortisedTau = 0;
+    amortisedFramePending = true;
+}
+
+void GuitarPitchDetectionFX::continueAmortisedFrame()
+{
+    if (! amortisedFramePending)
+        return;
+
+    constexpr int lagStep = VectorOps::squaredDistanceLagCount;
+    const int budget = (lagBudget + lagStep - 1) / lagStep * lagStep;
+    const int tauEnd = juce::jmin (windowSize, amortisedTau + budget);
+
+    computeDifferenceRange (amortisedTau, tauEnd);
+    amortisedTau = tauEnd;
+
+    if (amortisedTau < windowSize)
+        return;
+
+    amortisedFramePending = false;
+    publishResult (pitchFromDifference());
+}
+
+// rms is the level of the frame the result came from, the 2 * W samples of a Yin frame or the polyphonic spectrum frame
+void GuitarPitchDetectionFX::publishResult (float detectedPitch) noexcept
+{
+    pitch.store (detectedPitch, std::memory_order::memory_order_release);
+
+    PitchResult result;
+    result.pitch = detectedPitch;
+    result.aperiodicity = frameAperiodicity;
+    result.rms = frameRms;
+    result.time = static_cast<double> (frameEndSample) / analysisRate;
+
+    pushResult (result);
+}
+
+void GuitarPitchDetectionFX::pushResult (PitchResult result) noexcept
+{
+    result.frame = frameCount;
+    latestResult.store (result);
+
+    int start1, size1, start2, size2;
+    resultFifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        resultQueue[static_cast<size_t> (start1)] = result;
+
+    resultFifo.finishedWrite (size1);
+    ++frameCount;
+}
+
+// Hysteresis on the hop that has just arrived. The peak opens it too so a pluck at the very end of a quiet hop
+// is not held back a whole hop.
+bool GuitarPitchDetectionFX::updateGate() noexcept
+{
+    const float openLevel = gateOpenLevel.load (std::memory_order_relaxed);
+    const float closeLevel = openLevel * juce::Decibels::decibelsToGain (-gateHysteresisDb);
+
+    hopLevel = std::sqrt (hopSumOfSquares / static_cast<float> (juce::jmax (1, samplesSinceLastFrame)));
+    gateOpen = juce::jmax (hopLevel, hopPeak / gateCrestFactor) >= (gateOpen ? closeLevel : openLevel);
+
+    hopSumOfSquares = 0.0f;
+    hopPeak = 0.0f;
+
+    return gateOpen;
+}
+
+// Nothing is copied or computed for a gated frame. The incremental running sums stop following the signal so they
+// are rebuilt on the next open frame, and an amortised frame still in progress is dropped as out of date.
+void GuitarPitchDetectionFX::skipFrame() noexcept
+{
+    runningDiffValid = false;
+    amortisedFramePending = false;
+    frameAperiodicity = 1.0f;
+
+    pitch.store (-1.0f, std::memory_order::memory_order_release);
+
+    for (auto& stringPitch : stringPitches)
+        stringPitch.store (-1.0f, std::memory_order_release);
+
+    PitchResult result;
+    result.rms = hopLevel;
+    result.time = static_cast<double> (analysedSampleCount) / analysisRate;
+    result.gated = true;
+
+    pushResult (result);
+    skippedFrames.fetch_add (1, std::memory_order_relaxed);
+}
+
+bool GuitarPitchDetectionFX::popResult (PitchResult& result) noexcept
+{
+    int start1, size1, start2, size2;
+    resultFifo.prepareToRead (1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+        return false;
+
+    result = resultQueue[static_cast<size_t> (start1)];
+    resultFifo.finishedRead (1);
+    return true;
+}
+
+// Called before sigBuffer moves on by hop samples, removes the terms j < hop that leave the window
+// while the previous frame is still in sigBuffer
+void GuitarPitchDetectionFX::prepareIncrementalFrame (int hop)
+{
+    const bool canSlide = runningDiffValid && hop <= windowSize && framesSinceResync + 1 < resyncInterval;
+    slideHop = canSlide ? hop : 0;
+
+    if (slideHop == 0)
+        return;
+
+    const auto W = static_cast<size_t> (windowSize);
+    float leaving[VectorOps::squaredDistanceLagCount];
+
+    for (size_t tau = 0; tau < W; tau += VectorOps::squaredDistanceLagCount)
+    {
+        VectorOps::squaredDistanceLags (&sigBuffer[0], &sigBuffer[tau], leaving, slideHop);
+
+        for (size_t k = 0; k < VectorOps::squaredDistanceLagCount; ++k)
+            runningDiff[tau + k] -= leaving[k];
+    }
 }
 
 void GuitarPitchDetectionFX::computeDifference()
 {
+    const auto W = static_cast<size_t> (windowSize);
     float delta = 0.0f;
 
-    for (size_t tau = 0; tau < halfBufferSize; ++tau)
+    for (size_t tau = 0; tau < W; ++tau)
     {
         diffBuffer[tau] = 0.0f;
 
-        for (size_t j = 0; j < halfBufferSize; ++j)
+        for (size_t j = 0; j < W; ++j)
         {
             delta = sigBuffer[j] - sigBuffer[j + tau];
             diffBuffer[tau] += delta * delta;
@@ -61,77 +534,731 @@ void GuitarPitchDetectionFX::computeDifference()
     }
 }
 
-// Vector operations made this 13 times faster
-// I suspect we can do this using a frequency domain version, for better performance
+// Fused multi-lag kernel, the signal is read once per squaredDistanceLagCount taus with no scratch buffer
+// Kept as the reference engine, computeDifferenceFFT is the frequency domain version
 void GuitarPitchDetectionFX::computeDifferenceV2()
 {
-    juce::FloatVectorOperations::clear (&scratch[0], halfBufferSize);
+    computeDifferenceRange (0, windowSize);
+}
+
+// tauBegin and tauEnd must be multiples of squaredDistanceLagCount
+void GuitarPitchDetectionFX::computeDifferenceRange (int tauBegin, int tauEnd)
+{
+    for (auto tau = static_cast<size_t> (tauBegin); tau < static_cast<size_t> (tauEnd); tau += VectorOps::squaredDistanceLagCount)
+        VectorOps::squaredDistanceLags (&sigBuffer[0], &sigBuffer[tau], &diffBuffer[tau], windowSize);
+}
+
+// d(tau) = r(0) over [0, W) + r(0) over [tau, tau + W) - 2 * r(tau)
+// The power terms are a running sum of squares, r(tau) is a single FFT cross-correlation of the
+// first W samples against the 2 * W sample frame. Zero padding to the fft size means no lag < W wraps.
+void GuitarPitchDetectionFX::computeDifferenceFFT()
+{
+    const auto W = static_cast<size_t> (windowSize);
+    const auto fftLength = static_cast<size_t> (fft->getSize()) * 2;
+
+    juce::FloatVectorOperations::clear (&fftWindow[0], static_cast<int> (fftLength));
+    juce::FloatVectorOperations::copy (&fftWindow[0], &sigBuffer[0], windowSize);
+
+    juce::FloatVectorOperations::clear (&fftSignal[0], static_cast<int> (fftLength));
+    juce::FloatVectorOperations::copy (&fftSignal[0], &sigBuffer[0], windowSize * 2);
 
-    for (size_t tau = 0; tau < halfBufferSize; ++tau)
+    fft->performRealOnlyForwardTransform (&fftWindow[0]);
+    fft->performRealOnlyForwardTransform (&fftSignal[0]);
+
+    // conj (window) * signal, in place in fftSignal
+    for (size_t i = 0; i < fftLength; i += 2)
     {
-        juce::FloatVectorOperations::subtract (&scratch[0], &sigBuffer[0], &sigBuffer[tau], halfBufferSize);
-        juce::FloatVectorOperations::multiply (&scratch[0], &scratch[0], &scratch[0], halfBufferSize);
+        const float wr = fftWindow[i];
+        const float wi = fftWindow[i + 1];
+        const float sr = fftSignal[i];
+        const float si = fftSignal[i + 1];
 
-        VectorOps::sum (&scratch[0], &diffBuffer[tau], halfBufferSize);
+        fftSignal[i]     = wr * sr + wi * si;
+        fftSignal[i + 1] = wr * si - wi * sr;
+    }
+
+    fft->performRealOnlyInverseTransform (&fftSignal[0]);
+
+    double windowPower = 0.0;
+
+    for (size_t j = 0; j < W; ++j)
+        windowPower += static_cast<double> (sigBuffer[j]) * sigBuffer[j];
+
+    double lagPower = windowPower;
+
+    for (size_t tau = 0; tau < W; ++tau)
+    {
+        const double d = windowPower + lagPower - 2.0 * static_cast<double> (fftSignal[tau]);
+        diffBuffer[tau] = static_cast<float> (std::max (0.0, d));
+
+        lagPower += static_cast<double> (sigBuffer[tau + W]) * sigBuffer[tau + W]
+                  - static_cast<double> (sigBuffer[tau]) * sigBuffer[tau];
     }
 }
 
-void GuitarPitchDetectionFX::computeCumulativeMean()
+// Adds the terms j >= W - hop that entered the window, O(hop * W) instead of O(W * W).
+// Running sums are doubles and get rebuilt from the lag loop every resyncInterval frames to bound drift.
+void GuitarPitchDetectionFX::computeDifferenceIncremental()
 {
-    float sum = 0.0f;
+    const auto W = static_cast<size_t> (windowSize);
+
+    if (slideHop == 0)
+    {
+        computeDifferenceV2();
+
+        for (size_t tau = 0; tau < W; ++tau)
+            runningDiff[tau] = diffBuffer[tau];
 
-    for (size_t tau = 0; tau < halfBufferSize; ++tau)
+        runningDiffValid = true;
+        framesSinceResync = 0;
+        return;
+    }
+
+    const size_t start = W - static_cast<size_t> (slideHop);
+    float entering[VectorOps::squaredDistanceLagCount];
+
+    for (size_t tau = 0; tau < W; tau += VectorOps::squaredDistanceLagCount)
     {
-        if (tau == 0 || diffBuffer[tau] == 0.0f)
+        VectorOps::squaredDistanceLags (&sigBuffer[start], &sigBuffer[start + tau], entering, slideHop);
+
+        for (size_t k = 0; k < VectorOps::squaredDistanceLagCount; ++k)
         {
-            cumulativeBuffer[tau] = 1.0f;
+            runningDiff[tau + k] += entering[k];
+            diffBuffer[tau + k] = static_cast<float> (std::max (0.0, runningDiff[tau + k]));
+        }
+    }
+
+    ++framesSinceResync;
+}
+
+// Carries the cumulative mean on from lagsReady to tauEnd, a lazy search extends it a chunk at a time
+void GuitarPitchDetectionFX::computeCumulativeMean (int tauEnd)
+{
+    YinSearch::cumulativeMean (diffBuffer, 1, cumulativeBuffer, lagsReady, tauEnd, cumulativeSum);
+    lagsReady = juce::jmax (lagsReady, tauEnd);
+}
+
+// Makes lags [0, tauEnd) valid, only does anything while the difference function is being computed lazily
+void GuitarPitchDetectionFX::prepareLags (int tauEnd)
+{
+    if (tauEnd <= lagsReady || ! lazyDifference)
+        return;
+
+    constexpr int lagStep = VectorOps::squaredDistanceLagCount;
+    const int end = juce::jmin (windowSize, (juce::jmax (tauEnd, lagsReady + tauSearchChunk) + lagStep - 1) / lagStep * lagStep);
+
+    computeDifferenceRange (lagsReady, end);
+    computeCumulativeMean (end);
+}
+
+int GuitarPitchDetectionFX::absoluteThreshold()
+{
+    return YinSearch::absoluteThreshold (cumulativeBuffer, minTau, windowSize, threshold, tauLookAhead,
+                                         [this] (int tauEnd) { prepareLags (tauEnd); });
+}
+
+float GuitarPitchDetectionFX::parabolicInterpolation (int tau)
+{
+    return YinSearch::parabolicInterpolation (diffBuffer, 1, tau, windowSize);
+}
+
+float GuitarPitchDetectionFX::detectPitch()
+{
+    if (activeDifferenceEngine == DifferenceEngine::incremental)
+    {
+        computeDifferenceIncremental();
+    }
+    else
+    {
+        runningDiffValid = false;
+
+        if (activeDifferenceEngine == DifferenceEngine::fft)
+            computeDifferenceFFT();
+        else if (activeTauSearch == TauSearch::earlyExit)
+            return pitchFromDifference (true);
+        else if (activeTauSearch == TauSearch::coarseToFine && coarseStep > 0)
+            return pitchFromCoarseSearch();
+        else
+            computeDifferenceV2();
+    }
+
+    return pitchFromDifference();
+}
+
+// lazy computes the time domain difference function as the search reaches it, otherwise diffBuffer is complete
+float GuitarPitchDetectionFX::pitchFromDifference (bool lazy)
+{
+    lazyDifference = lazy;
+    lagsReady = 0;
+    cumulativeSum = 0.0f;
+
+    if (! lazy)
+        computeCumulativeMean (windowSize);
+
+    const int tau = absoluteThreshold();
+
+    frameAperiodicity = tau == -1 ? 1.0f : cumulativeBuffer[static_cast<size_t> (tau)];
+
+    if (tau == -1)
+        return static_cast<float> (tau);
+
+    prepareLags (juce::jmin (windowSize, tau + 2));
+
+    return analysisRate / parabolicInterpolation (tau);
+}
+
+// Scans the coarse estimate the way absoluteThreshold scans the full function, with the threshold relaxed by
+// coarseCandidateMargin because the estimate is only close, in the attack of a note it can read half as high again
+// as the full function. Each dip is refined at the full rate and the first one that is under the threshold there
+// wins, so a dip the estimate lets through by mistake cannot cause an octave error.
+float GuitarPitchDetectionFX::pitchFromCoarseSearch()
+{
+    runningDiffValid = false;
+    computeCoarseDifference();
+
+    const int coarseWindow = windowSize / coarseStep;
+    const float coarseThreshold = threshold * coarseCandidateMargin;
+    int numCandidates = 0;
+
+    frameAperiodicity = 1.0f;
+
+    for (int t = juce::jmax (1, minTau / coarseStep); t < coarseWindow && numCandidates < maxCoarseCandidates; ++t)
+    {
+        if (coarseCumulativeMean (t) >= coarseThreshold)
             continue;
+
+        int best = t;
+
+        for (int next = t + 1; next < coarseWindow && next <= best + 1 + tauLookAhead / coarseStep; ++next)
+            if (coarseCumulativeMean (next) < coarseCumulativeMean (best))
+                best = next;
+
+        ++numCandidates;
+
+        float aperiodicity = 1.0f;
+        const int tau = refineCoarseCandidate (best, aperiodicity);
+
+        if (aperiodicity < threshold)
+        {
+            frameAperiodicity = aperiodicity;
+            return analysisRate / parabolicInterpolation (tau);
         }
 
-        sum += diffBuffer[tau];
-        cumulativeBuffer[tau] = diffBuffer[tau] / ((1.0f / static_cast<float> (tau)) * sum);
+        // on past the rest of this dip
+        t = best;
+
+        while (t + 1 < coarseWindow && coarseCumulativeMean (t + 1) < coarseThreshold)
+            ++t;
     }
+
+    return -1.0f;
 }
 
-int GuitarPitchDetectionFX::absoluteThreshold()
+// Estimates the full rate difference function every coarseStep lags. d (tau) = e (0) + e (tau) - 2 * r (tau), where
+// e are the energies of the W samples at 0 and at tau and r the cross term. The energies are running sums at the
+// full rate, only r comes from the lag loop over a boxcar decimated copy of the frame, where r (D * t) ~ D * rc (t).
+// Noise above the decimated band still shows in the energies, so the estimate has the level of the full function.
+void GuitarPitchDetectionFX::computeCoarseDifference()
+{
+    constexpr int lagStep = VectorOps::squaredDistanceLagCount;
+    const int D = coarseStep;
+    const int W = windowSize;
+    const int coarseWindow = W / D;
+    const int coarseLength = coarseWindow * 2;
+    const float scale = 1.0f / static_cast<float> (D);
+
+    for (int i = 0; i < coarseLength; ++i)
+    {
+        float sum = 0.0f;
+
+        for (int k = 0; k < D; ++k)
+            sum += sigBuffer[i * D + k];
+
+        coarseSignal[i] = sum * scale;
+    }
+
+    juce::FloatVectorOperations::clear (&coarseSignal[coarseLength], lagStep);
+
+    for (int t = 0; t < coarseWindow; t += lagStep)
+        VectorOps::squaredDistanceLags (&coarseSignal[0], &coarseSignal[t], &coarseDiffBuffer[t], coarseWindow);
+
+    double windowPower = 0.0;
+    double coarseWindowPower = 0.0;
+
+    for (int j = 0; j < W; ++j)
+        windowPower += static_cast<double> (sigBuffer[j]) * sigBuffer[j];
+
+    for (int i = 0; i < coarseWindow; ++i)
+        coarseWindowPower += static_cast<double> (coarseSignal[i]) * coarseSignal[i];
+
+    double lagPower = windowPower;
+    double coarseLagPower = coarseWindowPower;
+    float sum = 0.0f;
+
+    for (int t = 0; t < coarseWindow; ++t)
+    {
+        // D * dc + (energies at the full rate - D * energies of the decimated copy), the cancellation in double
+        const double energyDifference = windowPower + lagPower - D * (coarseWindowPower + coarseLagPower);
+        const double d = D * static_cast<double> (coarseDiffBuffer[t]) + energyDifference;
+
+        coarseDiffBuffer[t] = t == 0 ? 0.0f : static_cast<float> (std::max (0.0, d));
+        sum += static_cast<float> (D) * coarseDiffBuffer[t];
+        coarseSumBuffer[t] = sum;
+
+        const int tau = t * D;
+
+        for (int k = 0; k < D; ++k)
+            lagPower += static_cast<double> (sigBuffer[tau + k + W]) * sigBuffer[tau + k + W]
+                      - static_cast<double> (sigBuffer[tau + k]) * sigBuffer[tau + k];
+
+        coarseLagPower += static_cast<double> (coarseSignal[t + coarseWindow]) * coarseSignal[t + coarseWindow]
+                        - static_cast<double> (coarseSignal[t]) * coarseSignal[t];
+    }
+}
+
+float GuitarPitchDetectionFX::coarseCumulativeMean (int coarseTau) const noexcept
+{
+    const auto index = static_cast<size_t> (coarseTau);
+
+    if (coarseTau == 0 || coarseSumBuffer[index] <= 0.0f)
+        return 1.0f;
+
+    return coarseDiffBuffer[index] * static_cast<float> (coarseTau * coarseStep) / coarseSumBuffer[index];
+}
+
+// Sum of the difference function over lags [1, tauEnd) without computing them. With e the energy of the W samples
+// at a lag and r the cross term it is (tauEnd - 1) * e (0) + the sum of e (tau) - 2 * the sum of r (tau), and the
+// cross terms of all those lags add up to one product of the frame with a moving sum of the samples after each.
+double GuitarPitchDetectionFX::differenceSum (int tauEnd) const noexcept
 {
-    for (size_t tau = 0; tau < halfBufferSize; ++tau)
+    const int W = windowSize;
+    const int numLags = tauEnd - 1;
+
+    if (numLags <= 0)
+        return 0.0;
+
+    double energy = 0.0;
+
+    for (int j = 0; j < W; ++j)
+        energy += static_cast<double> (sigBuffer[j]) * sigBuffer[j];
+
+    double lagEnergy = energy;
+    double lagEnergySum = 0.0;
+
+    for (int tau = 1; tau <= numLags; ++tau)
     {
-        if (cumulativeBuffer[tau] < threshold)
+        lagEnergy += static_cast<double> (sigBuffer[tau + W - 1]) * sigBuffer[tau + W - 1]
+                   - static_cast<double> (sigBuffer[tau - 1]) * sigBuffer[tau - 1];
+        lagEnergySum += lagEnergy;
+    }
+
+    // samples i + 1 to i + numLags
+    double following = 0.0;
+
+    for (int j = 1; j <= numLags; ++j)
+        following += sigBuffer[j];
+
+    double cross = 0.0;
+
+    for (int i = 0; i < W; ++i)
+    {
+        cross += static_cast<double> (sigBuffer[i]) * following;
+        following += static_cast<double> (sigBuffer[i + numLags + 1]) - sigBuffer[i + 1];
+    }
+
+    return numLags * energy + lagEnergySum - 2.0 * cross;
+}
+
+// Full rate lags within coarseStep of the coarse dip, widened while the lowest one sits on an edge. Only these
+// lags of diffBuffer and cumulativeBuffer are valid afterwards, including the neighbours parabolicInterpolation reads.
+// The cumulative mean carries on from the exact sum of the lags below them so it matches the full search.
+int GuitarPitchDetectionFX::refineCoarseCandidate (int coarseTau, float& aperiodicity)
+{
+    constexpr int lagStep = VectorOps::squaredDistanceLagCount;
+    const int D = coarseStep;
+    const int W = windowSize;
+    const int first = juce::jmax (1, minTau);
+
+    int low = juce::jlimit (first, W - 2, (coarseTau - 1) * D);
+    int high = juce::jlimit (low, W - 2, (coarseTau + 1) * D);
+    int computedBegin = 0;
+    int computedEnd = 0;
+    int best = low;
+
+    const auto computeLags = [&] (int begin, int end)
+    {
+        begin = begin / lagStep * lagStep;
+        end = juce::jmin (W, (end + lagStep - 1) / lagStep * lagStep);
+
+        if (computedEnd == 0)
         {
-            while (tau + 1 < halfBufferSize && cumulativeBuffer[tau + 1] < cumulativeBuffer[tau])
-            {
-                tau += 1;
-            }
+            computeDifferenceRange (begin, end);
+            computedBegin = begin;
+            computedEnd = end;
+            return;
+        }
+
+        if (begin < computedBegin)
+        {
+            computeDifferenceRange (begin, computedBegin);
+            computedBegin = begin;
+        }
+
+        if (end > computedEnd)
+        {
+            computeDifferenceRange (computedEnd, end);
+            computedEnd = end;
+        }
+    };
 
-            return static_cast<int> (tau);
+    // the sum of the lags below the computed ones only changes when they are extended downwards
+    int sumBegin = -1;
+    double sumBelow = 0.0;
+
+    const auto computeCumulativeMean = [&]
+    {
+        if (sumBegin != computedBegin)
+        {
+            sumBelow = differenceSum (computedBegin);
+            sumBegin = computedBegin;
         }
+
+        auto sum = static_cast<float> (sumBelow);
+        YinSearch::cumulativeMean (diffBuffer, 1, cumulativeBuffer, computedBegin, computedEnd, sum);
+    };
+
+    for (int step = 0; step < maxRefineSteps; ++step)
+    {
+        computeLags (low - 1, high + 2);
+        computeCumulativeMean();
+        best = low;
+
+        for (int tau = low + 1; tau <= high; ++tau)
+            if (cumulativeBuffer[static_cast<size_t> (tau)] < cumulativeBuffer[static_cast<size_t> (best)])
+                best = tau;
+
+        if (best == low && low > first)
+            low = juce::jmax (first, low - D);
+        else if (best == high && high < W - 2)
+            high = juce::jmin (W - 2, high + D);
+        else
+            break;
     }
 
-    return -1;
+    computeLags (best - 1, best + 2);
+    computeCumulativeMean();
+    aperiodicity = cumulativeBuffer[static_cast<size_t> (best)];
+
+    return best;
 }
 
-float GuitarPitchDetectionFX::parabolicInterpolation (int tau)
+// Hann windowed magnitudes of the last spectrumLength samples, windowed straight out of the ring.
+// Bins [0, fftSize / 2] end up at the start of fftSignal.
+void GuitarPitchDetectionFX::computeMagnitudeSpectrum()
 {
-    if (tau < 1 || tau >= static_cast <int> (cumulativeBuffer.size()) - 1)
-        return static_cast<float> (tau);
+    const auto oldest = (ringWritePos + static_cast<size_t> (ringSize - spectrumLength)) & static_cast<size_t> (ringSize - 1);
+    const int tail = juce::jmin (spectrumLength, ringSize - static_cast<int> (oldest));
 
-    const auto index = static_cast<size_t> (tau);
-    const float s0 = cumulativeBuffer[index - 1];
-    const float s1 = cumulativeBuffer[index];
-    const float s2 = cumulativeBuffer[index + 1];
+    juce::FloatVectorOperations::clear (&fftSignal[0], fft->getSize() * 2);
+    juce::FloatVectorOperations::multiply (&fftSignal[0], &ringBuffer[oldest], &spectrumWindow[0], tail);
+    juce::FloatVectorOperations::multiply (&fftSignal[tail], &ringBuffer[0], &spectrumWindow[tail], spectrumLength - tail);
+    frameEndSample = analysedSampleCount;
 
-    return static_cast <float> (index) + (s2 - s0) / (2.0f * (2.0f * s1 - s2 - s0));
+    // level of the unwindowed frame, the same measure as a Yin frame's
+    float tailSquares = 0.0f;
+    float headSquares = 0.0f;
+    VectorOps::sumOfSquares (&ringBuffer[oldest], &tailSquares, tail);
+    VectorOps::sumOfSquares (&ringBuffer[0], &headSquares, spectrumLength - tail);
+    frameRms = std::sqrt ((tailSquares + headSquares) / static_cast<float> (spectrumLength));
+
+    fft->performFrequencyOnlyForwardTransform (&fftSignal[0], true);
 }
 
-float GuitarPitchDetectionFX::detectPitch()
+float GuitarPitchDetectionFX::magnitudeAt (float frequency) const noexcept
 {
-    computeDifferenceV2();
-    computeCumulativeMean();
-    const int tau = absoluteThreshold();
+    const float bin = frequency * static_cast<float> (fft->getSize()) / analysisRate;
+    const auto index = static_cast<size_t> (bin);
 
-    if (tau == -1)
-        return static_cast<float> (tau);
+    if (index + 1 > static_cast<size_t> (fft->getSize() / 2))
+        return 0.0f;
 
-    return sampleRate / parabolicInterpolation (tau);
-}
\ No newline at end of file
+    const float frac = bin - static_cast<float> (index);
+    return fftSignal[index] + frac * (fftSignal[index + 1] - fftSignal[index]);
+}
+
+// A harmonic near one claimed by a lower string is still counted when it is well above what that string is
+// expected to have there, a strong fundamental sitting on a weak upper partial belongs to the higher string
+bool GuitarPitchDetectionFX::isClaimed (float frequency, const HarmonicClaim* claims, int numClaims) const noexcept
+{
+    constexpr float claimLevelRatio = 1.5f;
+    const float tolerance = 2.0f * analysisRate / static_cast<float> (fft->getSize());
+
+    for (int i = 0; i < numClaims; ++i)
+        if (std::abs (frequency - claims[i].frequency) < tolerance)
+            return magnitudeAt (frequency) < claims[i].level * claimLevelRatio;
+
+    return false;
+}
+
+// Magnitude over the harmonics below nyquist that no lower string has claimed, weighted by 1 / h so a single
+// strong upper partial shared with another string cannot outscore a missing fundamental
+float GuitarPitchDetectionFX::harmonicSum (float frequency, const HarmonicClaim* claims, int numClaims) const noexcept
+{
+    const float nyquist = analysisRate * 0.5f;
+    float sum = 0.0f;
+    float totalWeight = 0.0f;
+
+    for (int h = 1; h <= maxHarmonics && frequency * static_cast<float> (h) < nyquist; ++h)
+    {
+        const float harmonic = frequency * static_cast<float> (h);
+
+        if (isClaimed (harmonic, claims, numClaims))
+            continue;
+
+        const float weight = 1.0f / static_cast<float> (h);
+        sum += weight * magnitudeAt (harmonic);
+        totalWeight += weight;
+    }
+
+    return totalWeight > 0.0f ? sum / totalWeight : 0.0f;
+}
+
+// Each harmonic peak is located to a fraction of a bin with a parabola through the log magnitudes and divided back
+// down to a fundamental, higher harmonics pin the frequency down more so they weigh more. Peaks under minPeak are
+// noise. Harmonics whose main lobe overlaps a harmonic of another string in others are skipped, they would pull the
+// vertex towards that string. When every harmonic overlaps, as for a B sitting on the third harmonic of a low E, the
+// ones that coincide with the other string to within a bin are used, their two peaks merge into one whose vertex is
+// no further off than the other string is.
+float GuitarPitchDetectionFX::refineFromHarmonics (float frequency, float minPeak, const HarmonicClaim* others, int numOthers) const noexcept
+{
+    const float binHz = analysisRate / static_cast<float> (fft->getSize());
+    const float resolution = analysisRate / static_cast<float> (spectrumLength);
+    const float overlap = 4.0f * resolution;
+    const int lastBin = fft->getSize() / 2 - 1;
+    float weightedSum = 0.0f;
+    float totalWeight = 0.0f;
+
+    for (int pass = 0; pass < 2 && totalWeight <= 0.0f; ++pass)
+    {
+        for (int h = 1; h <= maxHarmonics; ++h)
+        {
+            const float harmonic = frequency * static_cast<float> (h);
+            int bin = static_cast<int> (std::round (harmonic / binHz));
+
+            if (bin < 2 || bin >= lastBin)
+                break;
+
+            float nearest = overlap;
+
+            for (int i = 0; i < numOthers; ++i)
+                nearest = juce::jmin (nearest, std::abs (harmonic - others[i].frequency));
+
+            if (pass == 0 ? nearest < overlap : nearest >= resolution)
+                continue;
+
+            if (fftSignal[static_cast<size_t> (bin - 1)] > fftSignal[static_cast<size_t> (bin)])
+                --bin;
+            else if (fftSignal[static_cast<size_t> (bin + 1)] > fftSignal[static_cast<size_t> (bin)])
+                ++bin;
+
+            const auto index = static_cast<size_t> (bin);
+            const float peak = fftSignal[index];
+
+            if (fftSignal[index - 1] > peak || fftSignal[index + 1] > peak || peak <= minPeak)
+                continue;
+
+            const float s0 = std::log (fftSignal[index - 1] + 1.0e-12f);
+            const float s1 = std::log (peak);
+            const float s2 = std::log (fftSignal[index + 1] + 1.0e-12f);
+            const float offset = 0.5f * (s0 - s2) / (s0 - 2.0f * s1 + s2);
+
+            const float weight = peak * static_cast<float> (h);
+            weightedSum += weight * (static_cast<float> (bin) + offset) * binHz / static_cast<float> (h);
+            totalWeight += weight;
+        }
+    }
+
+    return totalWeight > 0.0f ? weightedSum / totalWeight : frequency;
+}
+
+// The magnitude string is expected to have at each of its harmonics. A harmonic within stringSearchCents of another
+// target note may carry that string too, so its level comes from the nearest harmonics on either side that do not,
+// interpolated in log magnitude.
+void GuitarPitchDetectionFX::claimHarmonics (float f0, const std::array<float, numStrings>& targets, size_t string,
+                                             HarmonicClaim* claims) const noexcept
+{
+    const float searchRatio = std::exp2 (stringSearchCents / 1200.0f);
+    std::array<bool, maxHarmonics> shared;
+
+    for (size_t h = 0; h < static_cast<size_t> (maxHarmonics); ++h)
+    {
+        const float harmonic = f0 * static_cast<float> (h + 1);
+        claims[h] = { harmonic, magnitudeAt (harmonic) };
+        shared[h] = false;
+
+        for (size_t s = 0; s < static_cast<size_t> (numStrings); ++s)
+            if (s != string && targets[s] > 0.0f && harmonic > targets[s] / searchRatio && harmonic < targets[s] * searchRatio)
+                shared[h] = true;
+    }
+
+    for (int h = 0; h < maxHarmonics; ++h)
+    {
+        if (! shared[static_cast<size_t> (h)])
+            continue;
+
+        int below = h - 1;
+        int above = h + 1;
+
+        while (below >= 0 && shared[static_cast<size_t> (below)])
+            --below;
+
+        while (above < maxHarmonics && shared[static_cast<size_t> (above)])
+            ++above;
+
+        if (below < 0 && above >= maxHarmonics)
+            continue;
+
+        if (below < 0 || above >= maxHarmonics)
+        {
+            claims[h].level = claims[below < 0 ? above : below].level;
+            continue;
+        }
+
+        const float belowLevel = std::log (claims[below].level + 1.0e-12f);
+        const float aboveLevel = std::log (claims[above].level + 1.0e-12f);
+        const float position = static_cast<float> (h - below) / static_cast<float> (above - below);
+        claims[h].level = std::exp (belowLevel + position * (aboveLevel - belowLevel));
+    }
+}
+
+// Fundamental within stringSearchCents of target whose unclaimed harmonics carry the most energy
+float GuitarPitchDetectionFX::searchString (float target, const HarmonicClaim* claims, int numClaims, float& score) const noexcept
+{
+    const float stepRatio = std::exp2 (stringStepCents / 1200.0f);
+    const int numCandidates = static_cast<int> (2.0f * stringSearchCents / stringStepCents) + 1;
+
+    float candidate = target * std::exp2 (-stringSearchCents / 1200.0f);
+    float best = target;
+    score = 0.0f;
+
+    for (int i = 0; i < numCandidates; ++i, candidate *= stepRatio)
+    {
+        const float candidateScore = harmonicSum (candidate, claims, numClaims);
+
+        if (candidateScore > score)
+        {
+            score = candidateScore;
+            best = candidate;
+        }
+    }
+
+    return best;
+}
+
+// One spectrum per frame. Strings are searched from the lowest target up and each string found claims its
+// harmonics, so the upper partials of a low string do not show up as the strings above it. A string is present
+// when its fundamental or second harmonic is an unclaimed peak and its unclaimed harmonics stand out from the
+// band average and from the strongest string. Returns the pitch of the strongest string.
+float GuitarPitchDetectionFX::detectStrings()
+{
+    constexpr float presenceOverFloor = 8.0f;
+    constexpr float presenceOverStrongest = 0.1f;
+
+    computeMagnitudeSpectrum();
+
+    const float binHz = analysisRate / static_cast<float> (fft->getSize());
+    const auto firstBin = static_cast<size_t> (juce::jmax (1.0f, 60.0f / binHz));
+    const auto lastBin = static_cast<size_t> (juce::jmin (static_cast<float> (fft->getSize() / 2), 1300.0f / binHz));
+
+    // median magnitude of the guitar band, the peaks of a full strum would drag a mean up to the peaks themselves
+    const auto numBandBins = static_cast<std::ptrdiff_t> (lastBin - firstBin);
+    std::copy (fftSignal + firstBin, fftSignal + lastBin, fftWindow);
+    std::nth_element (fftWindow, fftWindow + numBandBins / 2, fftWindow + numBandBins);
+    const float floor = fftWindow[static_cast<size_t> (numBandBins / 2)];
+
+    std::array<float, numStrings> targets;
+    std::array<size_t, numStrings> order;
+    float strongest = 0.0f;
+
+    for (size_t s = 0; s < static_cast<size_t> (numStrings); ++s)
+    {
+        targets[s] = targetNotes[s].load (std::memory_order_relaxed);
+        order[s] = s;
+
+        float score = 0.0f;
+
+        if (targets[s] > 0.0f)
+            searchString (targets[s], nullptr, 0, score);
+
+        strongest = juce::jmax (strongest, score);
+    }
+
+    std::sort (order.begin(), order.end(), [&targets] (size_t a, size_t b) { return targets[a] < targets[b]; });
+
+    const float presenceLevel = juce::jmax (floor * presenceOverFloor, strongest * presenceOverStrongest);
+    std::array<HarmonicClaim, numStrings * maxHarmonics> claims;
+    std::array<float, numStrings> candidates;
+    std::array<float, numStrings> levels;
+    std::array<bool, numStrings> present;
+    int numClaims = 0;
+
+    for (const auto s : order)
+    {
+        present[s] = false;
+
+        if (targets[s] <= 0.0f)
+            continue;
+
+        float level = 0.0f;
+        const float f0 = searchString (targets[s], claims.data(), numClaims, level);
+        const auto hasPeak = [&] (float frequency)
+        {
+            return magnitudeAt (frequency) > presenceLevel && ! isClaimed (frequency, claims.data(), numClaims);
+        };
+
+        candidates[s] = f0;
+        levels[s] = level;
+        present[s] = level > presenceLevel && (hasPeak (f0) || hasPeak (2.0f * f0));
+
+        if (present[s])
+        {
+            claimHarmonics (f0, targets, s, claims.data() + numClaims);
+            numClaims += maxHarmonics;
+        }
+    }
+
+    // no Yin value for a spectrum, report fully periodic when any string was found
+    frameAperiodicity = numClaims > 0 ? 0.0f : 1.0f;
+
+    // every string's claims are contiguous in order, refine each against the claims of the others
+    float strongestPitch = -1.0f;
+    float strongestLevel = 0.0f;
+    int claimStart = 0;
+
+    for (const auto s : order)
+    {
+        if (! present[s])
+        {
+            stringPitches[s].store (-1.0f, std::memory_order_release);
+            continue;
+        }
+
+        std::array<HarmonicClaim, numStrings * maxHarmonics> others;
+        const auto ownBegin = claims.begin() + claimStart;
+        const auto ownEnd = ownBegin + maxHarmonics;
+        const auto othersEnd = std::copy (ownEnd, claims.begin() + numClaims, std::copy (claims.begin(), ownBegin, others.begin()));
+
+        const float stringPitch = refineFromHarmonics (candidates[s], presenceLevel, others.data(), static_cast<int> (othersEnd - others.begin()));
+        stringPitches[s].store (stringPitch, std::memory_order_release);
+
+        if (levels[s] > strongestLevel)
+        {
+            strongestLevel = levels[s];
+            strongestPitch = stringPitch;
+        }
+
+        claimStart += maxHarmonics;
+    }
+
+    return strongestPitch;
+}
@@ -1,50 +1,494 @@
 #pragma once
 #include <JuceHeader.h>
-#include "RBJFilters.h"
+#include "BiquadCascade.h"
+#include "RBJFilterBank.h"
+#include "Decimator.h"
+#include "SeqLock.h"
 
 // Yin method pitch detection, uses difference method and averaging
 
 class GuitarPitchDetectionFX
 {
 public:
+    // timeDomain is the reference lag loop, fft computes the same difference function in O(N log N),
+    // incremental slides per-lag running sums by one hop and resyncs with the lag loop every resyncInterval frames
+    enum class DifferenceEngine
+    {
+        timeDomain,
+        fft,
+        incremental
+    };
+
+    // full computes the whole difference function before searching it. earlyExit computes the time domain
+    // difference a chunk of lags at a time with the cumulative mean and the threshold search following behind, and
+    // stops at the first minimum under the threshold, so a high note only pays for lags up to about its period.
+    // Both give the same pitch. coarseToFine searches an estimate of the difference function every coarse factor
+    // lags, taken from a decimated copy of the frame, and computes the full rate function only in a few lags around
+    // each dip it finds. The fft and incremental engines always compute every lag and search in full.
+    enum class TauSearch
+    {
+        full,
+        earlyExit,
+        coarseToFine
+    };
+
+    // audioThread runs detection inside process(), analysisThread only queues samples in process()
+    // and runs filtering and detection on a worker thread owned by the detector, amortised spreads the
+    // time domain lag loop of each frame over several process() calls for hosts that forbid threads
+    enum class ThreadingMode
+    {
+        audioThread,
+        analysisThread,
+        amortised
+    };
+
+    // monophonic is the Yin detector, polyphonic scores harmonic sums around each of the numStrings target
+    // notes in one magnitude spectrum per frame so a strum reports every string at once
+    enum class AnalysisMode
+    {
+        monophonic,
+        polyphonic
+    };
+
+    // Implementation of the band limit. doublePrecision is the default cascade, singlePrecision runs the same stages
+    // with float coefficients and state, filterBank runs the double stages through a one lane RBJFilterBank and moves
+    // to new corners without a ramp.
+    enum class BandLimitFilter
+    {
+        doublePrecision,
+        singlePrecision,
+        filterBank
+    };
+
+    static constexpr int numStrings = 6;
+
+    // pitch is -1 when the string was not found in the frame
+    struct StringResult
+    {
+        float pitch = -1.0f;
+        float cents = 0.0f;
+    };
+
+    // aperiodicity is the cumulative mean normalised difference at the chosen lag, 0 for a perfectly periodic
+    // frame and 1 when nothing was found. rms is the band limited level of the frame, time is the end of the
+    // frame in seconds of input since init(). gated frames had no signal, the level gate skipped detection and
+    // rms is the level of the last hop only.
+    struct PitchResult
+    {
+        float pitch = -1.0f;
+        float aperiodicity = 1.0f;
+        float rms = 0.0f;
+        juce::uint64 frame = 0;
+        double time = 0.0;
+        bool gated = false;
+    };
+
+    // W used when init() is given no window length and no frequency range is set
+    static constexpr int defaultWindowSize = 2048;
+    static constexpr int maxWindowSize = 16384;
+
+    // W is always rounded up to a multiple of this so the multi-lag kernels never run past it
+    static constexpr int windowGranularity = 4;
+    static constexpr size_t arenaAlignment = 64;
+
     GuitarPitchDetectionFX() = default;
-    ~GuitarPitchDetectionFX() = default;
+    ~GuitarPitchDetectionFX();
+
+    // windowLength is W, the longest lag searched, and every buffer is sized from it in one allocation.
+    // 0 sizes W from the analysis rate and the lowest frequency of setFrequencyRange(), or uses defaultWindowSize
+    // when no range is set. Allocates unless the detector was built with fixed storage that is large enough.
+    void init (int windowLength = 0);
 
-    void init();
+    // Applies a band limit moved by setBandLimit(), run at the start of every analysed block on the thread that
+    // filters, so there is no need to call it from outside
     void update();
     void process (float* audioStream, int numSamples);
     static std::string info() { return "GuitarPitchDetection"; }
 
     float getPitch() const noexcept { return pitch.load (std::memory_order::memory_order_relaxed); }
 
+    // Most recent result as one consistent snapshot, safe from any thread. Compare frame to skip repaints.
+    PitchResult getLatestResult() const noexcept { return latestResult.load(); }
+
+    // Every detection is also queued, single consumer. Results are dropped while the queue is full,
+    // getPitch() always has the latest.
+    bool popResult (PitchResult& result) noexcept;
+
+    // Samples the analysis thread could not keep up with
+    juce::uint64 getDroppedSampleCount() const noexcept { return droppedSamples.load (std::memory_order_relaxed); }
+
+    // Level gate ahead of detection, level is the stored sensitivity_level setting from 0 to 1. The gate opens when
+    // a hop's band limited RMS, or its peak over gateCrestFactor, reaches gateFloorDb + level * gateRangeDb dBFS and
+    // closes again gateHysteresisDb below that. Frames while it is closed publish a gated result and cost nothing
+    // beyond the band limit. 0 only gates silence. Safe from any thread.
+    void setSensitivity (float level) noexcept;
+
+    // Frames the level gate skipped since init()
+    juce::uint64 getSkippedFrameCount() const noexcept { return skippedFrames.load (std::memory_order_relaxed); }
+
+    // Polyphonic frames are always analysed whole, amortised threading only applies to the Yin lag loop.
+    // The spectrum covers the last 0.3 s whatever W and the internal rate are, enough to resolve the partials of
+    // neighbouring strings. Takes effect on the next init().
+    void setAnalysisMode (AnalysisMode mode) noexcept { analysisMode = mode; }
+
+    // Open string frequencies, usually the six notes of the current TuningInfo::TuningMode
+    void setTargetNotes (const std::array<float, numStrings>& frequencies) noexcept;
+
+    // Latest polyphonic result for one string, cents are relative to its target note
+    StringResult getStringResult (int string) const noexcept;
+
+    // Takes effect on the next init(), which also starts or stops the analysis thread
+    void setThreadingMode (ThreadingMode mode) noexcept { threadingMode = mode; }
+
+    // Lags of the difference function computed per process() call in amortised mode. Frames that become
+    // ready while one is still in progress are skipped, so the update rate is at most one frame per W / budget calls.
+    void setLagBudget (int taus) noexcept { lagBudget = juce::jmax (1, taus); }
+
     void setSampleRate (float sr) noexcept { sampleRate = sr; }
     void setThreshold (float value) { threshold = juce::jlimit (0.0f, 1.0f, value); }
 
+    // Take effect on the next init() like the threading and analysis modes
+    void setDifferenceEngine (DifferenceEngine engine) noexcept { differenceEngine = engine; }
+    void setTauSearch (TauSearch search) noexcept { tauSearch = search; }
+    void setBandLimitFilter (BandLimitFilter filter) noexcept { bandLimitFilter = filter; }
+
+    // Once the search has walked down to a minimum under the threshold it checks this many lags past it and carries
+    // on from any that is lower, so a ripple on the way down does not end the search. 0 stops at the first local minimum.
+    void setTauLookAhead (int lags) noexcept { tauLookAhead = juce::jmax (0, lags); }
+
+    // Decimation of the coarse pass of the coarseToFine search, 2 or 4. Takes effect on the next init(), which lowers
+    // it when the shortest period of setFrequencyRange() would not span minCoarsePeriod coarse lags, or searches in
+    // full when even 2 is too coarse.
+    void setCoarseFactor (int factor) noexcept { coarseFactor = factor > 2 ? 4 : 2; }
+
+    // Runs detection at sampleRate / n, the largest whole n that keeps the rate at or above targetHz.
+    // Takes effect on the next init(), 0 runs detection at the host rate.
+    void setInternalSampleRate (float targetHz) noexcept { internalSampleRate = targetHz; }
+
+    // Number of new samples at the internal rate between pitch updates, the analysis window always
+    // covers the most recent samples
+    void setHopSize (int samples) noexcept { hopSize = juce::jmax (1, samples); }
+
+    // Corners of the band limit ahead of detection, 60 Hz - 1 kHz by default. Safe from any thread, for example to
+    // follow the band around the target note every frame. The filters are retuned from coefficient caches and
+    // glide over bandLimitRampSamples so moving them does not zipper.
+    void setBandLimit (float lowHz, float highHz) noexcept;
+
+    // Restricts the lags searched to this range plus a guard band, and sizes the window to the longest period.
+    // Takes effect on the next init(), 0 leaves that end of the range unrestricted.
+    void setFrequencyRange (float minHz, float maxHz) noexcept { minFrequency = minHz; maxFrequency = maxHz; }
+
+    // Samples of the polyphonic spectrum frame at an analysis rate, independent of W
+    static constexpr int getSpectrumLength (float analysisRate) noexcept
+    {
+        return roundWindowSize (static_cast<int> (analysisRate * spectrumSeconds));
+    }
+
+    // Bytes of arena init() needs for a window of windowLength samples, before rounding to windowGranularity.
+    // withInputQueue adds the queue the analysis thread reads from, the other threading modes have none.
+    // spectrumLength is getSpectrumLength() of the analysis rate in polyphonic mode and 0 otherwise.
+    static constexpr size_t getArenaSize (int windowLength, bool withInputQueue = false, int spectrumLength = 0) noexcept
+    {
+        return getArenaLayout (windowLength, withInputQueue, spectrumLength).total;
+    }
+
+protected:
+    // Carves the buffers out of storage instead of the heap whenever the window fits, storage must be
+    // arenaAlignment aligned and outlive the detector
+    GuitarPitchDetectionFX (void* storage, size_t storageSize) noexcept
+        : externalArena (static_cast<std::byte*> (storage)), externalArenaSize (storageSize) {}
+
 private:
-    static constexpr int bufferSize = 4096;
-    static constexpr int halfBufferSize = bufferSize / 2;
+    friend class GuitarPitchDetectionFXBench;
+
+    static constexpr int maxBlockSize = 256;
+    static constexpr int resyncInterval = 64;
+    static constexpr int inputQueueSize = 16384;
+    static constexpr int resultQueueSize = 64;
+    static constexpr int maxHarmonics = 6;
+    static constexpr int bandLimitOrder = 2;
+    static constexpr int bandLimitRampSamples = 256;
+    static constexpr int tauSearchChunk = 32;
+    static constexpr int maxCoarseCandidates = 4;
+    static constexpr int maxRefineSteps = 4;
+    static constexpr float coarseCandidateMargin = 2.0f;
+    static constexpr float minCoarsePeriod = 3.0f;
+    static constexpr float stringSearchCents = 100.0f;
+    static constexpr float stringStepCents = 5.0f;
+    static constexpr float spectrumSeconds = 0.3f;
+    static constexpr float gateFloorDb = -90.0f;
+    static constexpr float gateRangeDb = 60.0f;
+    static constexpr float gateHysteresisDb = 6.0f;
+    static constexpr float gateCrestFactor = 2.0f;
 
     float threshold = 0.3f;
 
-    std::array<float, 4096> sigBuffer;
-    std::array<float, 4096> diffBuffer;
-    std::array<float, 4096> cumulativeBuffer;
+    float minFrequency = 0.0f;
+    float maxFrequency = 0.0f;
+
+    // W, the difference function is integrated over W samples for lags [0, W) of the last 2 * W samples
+    int windowSize = defaultWindowSize;
+    int minTau = 0;
+
+    // Byte offsets of every buffer for a window of W samples, each starts on its own cache line. The ring is the
+    // smallest power of two that holds a 2 * W sample frame and the spectrum frame, the fft the smallest that holds
+    // the spectrum frame in polyphonic mode and the 2 * W sample frame otherwise. Real-only transforms need 2 * fft size.
+    struct ArenaLayout
+    {
+        size_t ringSize = 0;
+        size_t fftSize = 0;
+        size_t ring = 0;
+        size_t signal = 0;
+        size_t difference = 0;
+        size_t cumulative = 0;
+        size_t fftSignal = 0;
+        size_t fftWindow = 0;
+        size_t spectrumWindow = 0;
+        size_t runningDiff = 0;
+        size_t coarseSignal = 0;
+        size_t coarseDifference = 0;
+        size_t coarseSum = 0;
+        size_t inputQueue = 0;
+        size_t total = 0;
+    };
+
+    static constexpr int roundWindowSize (int windowLength) noexcept
+    {
+        return (windowLength + windowGranularity - 1) / windowGranularity * windowGranularity;
+    }
 
-    std::array<float, halfBufferSize> scratch;
+    static constexpr ArenaLayout getArenaLayout (int windowLength, bool withInputQueue = false, int spectrumLength = 0) noexcept
+    {
+        const auto W = static_cast<size_t> (roundWindowSize (windowLength));
+        ArenaLayout layout;
+        size_t offset = 0;
 
-    size_t bufferSampleCnt = 0;
+        const auto add = [&offset] (size_t bytes)
+        {
+            const size_t start = offset;
+            offset += (bytes + arenaAlignment - 1) / arenaAlignment * arenaAlignment;
+            return start;
+        };
 
+        layout.ringSize = 1;
+
+        while (layout.ringSize < 2 * W || layout.ringSize < static_cast<size_t> (spectrumLength))
+            layout.ringSize *= 2;
+
+        layout.fftSize = 1;
+
+        while (layout.fftSize < (spectrumLength > 0 ? static_cast<size_t> (spectrumLength) : 2 * W))
+            layout.fftSize *= 2;
+
+        layout.ring = add (layout.ringSize * sizeof (float));
+        layout.signal = add (2 * W * sizeof (float));
+        layout.difference = add (W * sizeof (float));
+        layout.cumulative = add (W * sizeof (float));
+        layout.fftSignal = add (2 * layout.fftSize * sizeof (float));
+        layout.fftWindow = add (2 * layout.fftSize * sizeof (float));
+        layout.spectrumWindow = add (static_cast<size_t> (spectrumLength) * sizeof (float));
+        layout.runningDiff = add (W * sizeof (double));
+
+        // the coarse pass at its smallest factor of 2, padded for the last group of lags
+        layout.coarseSignal = add ((W + windowGranularity) * sizeof (float));
+        layout.coarseDifference = add ((W / 2 + windowGranularity) * sizeof (float));
+        layout.coarseSum = add ((W / 2 + windowGranularity) * sizeof (float));
+
+        if (withInputQueue)
+            layout.inputQueue = add (inputQueueSize * sizeof (float));
+
+        layout.total = offset;
+
+        return layout;
+    }
+
+    std::byte* externalArena = nullptr;
+    size_t externalArenaSize = 0;
+    std::unique_ptr<std::byte[]> ownedArena;
+    size_t ownedArenaSize = 0;
+
+    std::array<float, maxBlockSize> filterBuffer;
+    float* ringBuffer = nullptr;
+    float* sigBuffer = nullptr;
+    float* diffBuffer = nullptr;
+    float* cumulativeBuffer = nullptr;
+    int ringSize = 0;
+
+    float* fftSignal = nullptr;
+    float* fftWindow = nullptr;
+    std::unique_ptr<juce::dsp::FFT> fft;
+
+    // a harmonic of a string already accepted in this frame, level is that string's expected magnitude at it
+    struct HarmonicClaim
+    {
+        float frequency = 0.0f;
+        float level = 0.0f;
+    };
+
+    float* spectrumWindow = nullptr;
+    int spectrumLength = 0;
+    std::array<std::atomic<float>, numStrings> targetNotes { { 82.41f, 110.0f, 146.83f, 196.0f, 246.94f, 329.63f } };
+    std::array<std::atomic<float>, numStrings> stringPitches;
+
+    double* runningDiff = nullptr;
+    bool runningDiffValid = false;
+    int slideHop = 0;
+    int framesSinceResync = 0;
+
+    // Modes as last set, and the active ones init() copied from them while no worker was running. Only the active
+    // modes are read after init() so the audio and analysis threads never see them change.
+    ThreadingMode threadingMode = ThreadingMode::audioThread;
+    AnalysisMode analysisMode = AnalysisMode::monophonic;
+    DifferenceEngine differenceEngine = DifferenceEngine::timeDomain;
+    TauSearch tauSearch = TauSearch::full;
+    BandLimitFilter bandLimitFilter = BandLimitFilter::doublePrecision;
+    ThreadingMode activeThreadingMode = ThreadingMode::audioThread;
+    AnalysisMode activeAnalysisMode = AnalysisMode::monophonic;
+    DifferenceEngine activeDifferenceEngine = DifferenceEngine::timeDomain;
+    TauSearch activeTauSearch = TauSearch::full;
+    BandLimitFilter activeBandLimitFilter = BandLimitFilter::doublePrecision;
+
+    // lags [0, lagsReady) of diffBuffer and cumulativeBuffer are valid for the frame being searched
+    int tauLookAhead = 0;
+    bool lazyDifference = false;
+    int lagsReady = 0;
+    float cumulativeSum = 0.0f;
+
+    // coarseDiffBuffer estimates the full rate difference at lags coarseStep * t, coarseSumBuffer is its running sum
+    // in full rate lags for the cumulative mean of the estimate. Refined lags get the exact cumulative mean.
+    float* coarseSignal = nullptr;
+    float* coarseDiffBuffer = nullptr;
+    float* coarseSumBuffer = nullptr;
+    int coarseFactor = 4;
+    int coarseStep = 0;
+
+    // inputQueue is only in the arena when the analysis thread is active
+    juce::AbstractFifo inputFifo { inputQueueSize };
+    float* inputQueue = nullptr;
+    std::atomic<juce::uint64> droppedSamples { 0 };
+
+    juce::AbstractFifo resultFifo { resultQueueSize };
+    std::array<PitchResult, resultQueueSize> resultQueue;
+    juce::uint64 frameCount = 0;
+    SeqLock<PitchResult> latestResult;
+
+    // frameRms and frameEndSample describe the frame the next result comes from, set when it is taken from the ring
+    float frameAperiodicity = 1.0f;
+    float frameRms = 0.0f;
+    juce::uint64 analysedSampleCount = 0;
+    juce::uint64 frameEndSample = 0;
+
+    std::atomic<float> gateOpenLevel { juce::Decibels::decibelsToGain (gateFloorDb) };
+    std::atomic<juce::uint64> skippedFrames { 0 };
+    bool gateOpen = false;
+    float hopSumOfSquares = 0.0f;
+    float hopPeak = 0.0f;
+    float hopLevel = 0.0f;
+
+    int lagBudget = 256;
+    int amortisedTau = 0;
+    bool amortisedFramePending = false;
+
+    size_t ringWritePos = 0;
+    int hopSize = 512;
+    int samplesSinceLastFrame = 0;
+
+    void updateLagRange (int windowLength);
+    void allocateBuffers();
     void clearBuffers();
+    void setBandLimitCoeffs (const RBJ::Coefficients<double>& lowPass, const RBJ::Coefficients<double>& highPass, int rampSamples) noexcept;
+    void processBandLimit (const float* input, float* output, int numSamples) noexcept;
+    void analyseSamples (const float* samples, int numSamples);
+    void queueSamples (const float* samples, int numSamples) noexcept;
+    bool analyseQueuedSamples();
+    void publishResult (float detectedPitch) noexcept;
+    void pushResult (PitchResult result) noexcept;
+    bool updateGate() noexcept;
+    void skipFrame() noexcept;
+    void copyRingToSignalBuffer();
+    void analyseFrame();
+    void prepareIncrementalFrame (int hop);
     [[maybe_unused]] void computeDifference();
     void computeDifferenceV2();
+    void computeDifferenceRange (int tauBegin, int tauEnd);
+    void computeDifferenceFFT();
+    void computeDifferenceIncremental();
     int absoluteThreshold();
     float parabolicInterpolation (int tau);
-    void computeCumulativeMean();
+    void computeCumulativeMean (int tauEnd);
+    void prepareLags (int tauEnd);
     float detectPitch();
+    float pitchFromDifference (bool lazy = false);
+    float pitchFromCoarseSearch();
+    void computeCoarseDifference();
+    float coarseCumulativeMean (int coarseTau) const noexcept;
+    double differenceSum (int tauEnd) const noexcept;
+    int refineCoarseCandidate (int coarseTau, float& aperiodicity);
+    void computeMagnitudeSpectrum();
+    float magnitudeAt (float frequency) const noexcept;
+    bool isClaimed (float frequency, const HarmonicClaim* claims, int numClaims) const noexcept;
+    void claimHarmonics (float f0, const std::array<float, numStrings>& targets, size_t string, HarmonicClaim* claims) const noexcept;
+    float harmonicSum (float frequency, const HarmonicClaim* claims, int numClaims) const noexcept;
+    float refineFromHarmonics (float frequency, float minPeak, const HarmonicClaim* others, int numOthers) const noexcept;
+    float searchString (float target, const HarmonicClaim* claims, int numClaims, float& score) const noexcept;
+    float detectStrings();
+    void beginAmortisedFrame();
+    void continueAmortisedFrame();
 
     float sampleRate = 48000.0f;
+    float internalSampleRate = 0.0f;
+    float analysisRate = 48000.0f;
     std::atomic<float> pitch = 0.0f;
 
-    LPF lpf1, lpf2;
-    HPF hpf1, hpf2;
+    // band limit at the host rate, high corner on the two LPFs and low corner on the two HPFs. Double precision,
+    // at 192 kHz the 60 Hz HPF poles sit so close to 1 that float coefficients move the corner and add noise.
+    // The other two implementations are only used when setBandLimitFilter() picks them.
+    BiquadCascade<RBJ::LPF<double>, RBJ::LPF<double>, RBJ::HPF<double>, RBJ::HPF<double>> bandLimit;
+    BiquadCascade<RBJ::LPF<float>, RBJ::LPF<float>, RBJ::HPF<float>, RBJ::HPF<float>> singleBandLimit;
+    RBJFilterBank<1, 4, double> bandLimitBank;
+    RBJCoefficientCache<RBJ::LPF<double>> lowPassCache;
+    RBJCoefficientCache<RBJ::HPF<double>> highPassCache;
+    std::atomic<float> bandLowHz { 60.0f };
+    std::atomic<float> bandHighHz { 1000.0f };
+    float appliedBandLow = 0.0f;
+    float appliedBandHigh = 0.0f;
+    Decimator decimator;
+
+    class AnalysisThread : public juce::Thread
+    {
+    public:
+        explicit AnalysisThread (GuitarPitchDetectionFX& detector) : juce::Thread ("GuitarPitchDetection"), owner (detector) {}
+        ~AnalysisThread() override { stopThread (1000); }
+
+        void run() override;
+
+    private:
+        GuitarPitchDetectionFX& owner;
+    };
+
+    // last member so the worker stops before anything it uses is destroyed
+    std::unique_ptr<AnalysisThread> analysisThread;
+};
+
+template <int windowLength, bool withInputQueue>
+struct FixedPitchDetectionStorage
+{
+    alignas (GuitarPitchDetectionFX::arenaAlignment) std::array<std::byte, GuitarPitchDetectionFX::getArenaSize (windowLength, withInputQueue)> arena;
+};
+
+// The detector with its buffers inside the object for a window known at compile time, init() never allocates.
+// The storage is a base rather than a member so it is built before and destroyed after the detector and its thread.
+// withAnalysisThread also reserves the input queue, without it the analysis thread mode allocates its arena.
+// Polyphonic mode allocates too, its spectrum frame depends on the analysis rate.
+template <int windowLength = GuitarPitchDetectionFX::defaultWindowSize, bool withAnalysisThread = false>
+class FixedSizeGuitarPitchDetectionFX : private FixedPitchDetectionStorage<windowLength, withAnalysisThread>,
+                                        public GuitarPitchDetectionFX
+{
+public:
+    static_assert (windowLength > 0 && windowLength <= maxWindowSize);
+
+    FixedSizeGuitarPitchDetectionFX() noexcept
+        : GuitarPitchDetectionFX (this->arena.data(), this->arena.size()) {}
+
+    void init() { GuitarPitchDetectionFX::init (windowLength); }
 };
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "MultiChannelPitchDetectionFX.h"
+#include "YinSearch.h"
+
+void MultiChannelPitchDetectionFX::init()
+{
+    updateLagRange();
+
+    LPF lpf;
+    HPF hpf;
+    lpf.calculateCoeffs (1000.0f, sampleRate, 2);
+    hpf.calculateCoeffs (60.0f, sampleRate, 2);
+
+    bandLimit.setCoeffs (0, lpf);
+    bandLimit.setCoeffs (1, lpf);
+    bandLimit.setCoeffs (2, hpf);
+    bandLimit.setCoeffs (3, hpf);
+    bandLimit.reset();
+
+    // starts with a frame of silence like the mono detector's ring
+    const auto frameLength = static_cast<size_t> (windowSize * 2);
+    history.assign (frameLength + static_cast<size_t> (historySlack), Lanes {});
+    diffBuffer.assign (static_cast<size_t> (windowSize), Lanes {});
+    cumulativeBuffer.assign (static_cast<size_t> (windowSize), 0.0f);
+
+    historyWritePos = frameLength;
+    samplesSinceLastFrame = 0;
+    activeChannels = 0;
+
+    for (auto& pitch : pitches)
+        pitch.store (-1.0f, std::memory_order_relaxed);
+}
+
+// Same guard band as GuitarPitchDetectionFX::updateLagRange
+void MultiChannelPitchDetectionFX::updateLagRange()
+{
+    constexpr float guardRatio = 1.06f;
+    constexpr int guardSamples = 2;
+    constexpr int lagStep = VectorOps::squaredDistanceLagCount;
+
+    windowSize = maxWindowSize;
+    minTau = 0;
+
+    if (minFrequency > 0.0f)
+    {
+        const int longestPeriod = static_cast<int> (std::ceil (sampleRate * guardRatio / minFrequency)) + guardSamples;
+        const int rounded = (longestPeriod + lagStep - 1) / lagStep * lagStep;
+        windowSize = juce::jlimit (lagStep, maxWindowSize, rounded);
+    }
+
+    if (maxFrequency > 0.0f)
+    {
+        const int shortestPeriod = static_cast<int> (std::floor (sampleRate / (maxFrequency * guardRatio))) - guardSamples;
+        minTau = juce::jlimit (0, windowSize - 1, shortestPeriod);
+    }
+}
+
+void MultiChannelPitchDetectionFX::process (const float* const* channels, int numChannels, int numSamples)
+{
+    activeChannels = juce::jlimit (0, maxChannels, numChannels);
+
+    for (int start = 0; start < numSamples; start += maxBlockSize)
+    {
+        const int blockSize = juce::jmin (maxBlockSize, numSamples - start);
+
+        // interleave into lanes, unused lanes stay silent
+        for (int i = 0; i < blockSize; ++i)
+        {
+            auto& lanes = filterBuffer[static_cast<size_t> (i)];
+            lanes.fill (0.0f);
+
+            for (int c = 0; c < activeChannels; ++c)
+                lanes[static_cast<size_t> (c)] = channels[c][start + i];
+        }
+
+        bandLimit.process (filterBuffer[0].data(), blockSize);
+
+        for (int i = 0; i < blockSize; ++i)
+        {
+            writeHistory (filterBuffer[static_cast<size_t> (i)]);
+
+            if (++samplesSinceLastFrame < hopSize)
+                continue;
+
+            computeDifference();
+
+            for (size_t lane = 0; lane < static_cast<size_t> (activeChannels); ++lane)
+                pitches[lane].store (detectPitch (lane), std::memory_order_release);
+
+            samplesSinceLastFrame = 0;
+        }
+    }
+}
+
+// Once the slack is used up the last 2 * W samples move back to the start, so the frame never wraps
+void MultiChannelPitchDetectionFX::writeHistory (const Lanes& lanes) noexcept
+{
+    const auto frameLength = static_cast<size_t> (windowSize * 2);
+
+    if (historyWritePos == history.size())
+    {
+        memmove (&history[0], &history[historyWritePos - frameLength], sizeof (Lanes) * frameLength);
+        historyWritePos = frameLength;
+    }
+
+    history[historyWritePos++] = lanes;
+}
+
+// Four lags per pass over the frame like the single channel detector, every lane at once
+void MultiChannelPitchDetectionFX::computeDifference()
+{
+    const float* signal = history[historyWritePos - static_cast<size_t> (windowSize * 2)].data();
+
+    for (int tau = 0; tau < windowSize; tau += VectorOps::squaredDistanceLagCount)
+        VectorOps::squaredDistanceLagsInterleaved (signal, signal + tau * maxChannels, diffBuffer[static_cast<size_t> (tau)].data(), windowSize);
+}
+
+// Cumulative mean, absolute threshold and interpolation for one lane, shared with GuitarPitchDetectionFX
+float MultiChannelPitchDetectionFX::detectPitch (size_t lane)
+{
+    const float* difference = diffBuffer[0].data() + lane;
+    float sum = 0.0f;
+
+    YinSearch::cumulativeMean (difference, maxChannels, cumulativeBuffer.data(), 0, windowSize, sum);
+
+    const int tau = YinSearch::absoluteThreshold (cumulativeBuffer.data(), minTau, windowSize, threshold);
+
+    if (tau == -1)
+        return -1.0f;
+
+    return sampleRate / YinSearch::parabolicInterpolation (difference, maxChannels, tau, windowSize);
+}
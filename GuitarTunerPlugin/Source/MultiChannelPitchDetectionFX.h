@@ -0,0 +1,76 @@
+#pragma once
+#include <JuceHeader.h>
+#include "RBJFilterBank.h"
+#include "VectorOps.h"
+
+// Batched Yin pitch detection for hexaphonic pickups, one string per channel.
+// Samples are stored [sample][lane] so the band limit and the lag loop process every channel in the same
+// SIMD register, the lane count is padded to 8 to fill an AVX register. One set of buffers serves every channel,
+// sized by init() from the window of setFrequencyRange().
+
+class MultiChannelPitchDetectionFX
+{
+public:
+    static constexpr int maxChannels = VectorOps::interleavedLaneCount;
+
+    MultiChannelPitchDetectionFX() = default;
+    ~MultiChannelPitchDetectionFX() = default;
+
+    // Allocates the buffers for the window, so call it off the audio thread
+    void init();
+    void process (const float* const* channels, int numChannels, int numSamples);
+    static std::string info() { return "MultiChannelPitchDetection"; }
+
+    // -1 until the channel's first detection and whenever the last frame found no pitch
+    float getPitch (int channel) const noexcept
+    {
+        jassert (channel >= 0 && channel < maxChannels);
+        return pitches[static_cast<size_t> (channel)].load (std::memory_order_relaxed);
+    }
+
+    void setSampleRate (float sr) noexcept { sampleRate = sr; }
+    void setThreshold (float value) { threshold = juce::jlimit (0.0f, 1.0f, value); }
+    void setHopSize (int samples) noexcept { hopSize = juce::jlimit (1, 2 * maxWindowSize, samples); }
+
+    // Same meaning as GuitarPitchDetectionFX::setFrequencyRange, takes effect on the next init()
+    void setFrequencyRange (float minHz, float maxHz) noexcept { minFrequency = minHz; maxFrequency = maxHz; }
+
+private:
+    static constexpr int maxWindowSize = 2048;
+    static constexpr int maxBlockSize = 256;
+    static constexpr int numStages = 4;
+
+    // samples written past the frame before the history is moved back, one move of 2 * W samples every historySlack
+    static constexpr int historySlack = 512;
+
+    using Lanes = std::array<float, maxChannels>;
+
+    float threshold = 0.3f;
+    float sampleRate = 48000.0f;
+    float minFrequency = 0.0f;
+    float maxFrequency = 0.0f;
+
+    int windowSize = maxWindowSize;
+    int minTau = 0;
+    int hopSize = 512;
+    int activeChannels = 0;
+
+    // band limited samples, the frame is always the 2 * W before historyWritePos so the lag loop reads it in place
+    size_t historyWritePos = 0;
+    int samplesSinceLastFrame = 0;
+
+    // 60 Hz - 1 kHz band limit on every lane, LPF LPF HPF HPF
+    RBJFilterBank<maxChannels, numStages> bandLimit;
+
+    alignas (32) std::array<Lanes, maxBlockSize> filterBuffer;
+    std::vector<Lanes> history;
+    std::vector<Lanes> diffBuffer;
+    std::vector<float> cumulativeBuffer;
+
+    std::array<std::atomic<float>, maxChannels> pitches;
+
+    void updateLagRange();
+    void writeHistory (const Lanes& lanes) noexcept;
+    void computeDifference();
+    float detectPitch (size_t lane);
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include "RBJFilters.h"
+#include "Utils.h"
+
+namespace RBJ
+{
+    // One biquad's coefficients normalised so a0 is 1, the layout every block process function runs from
+    template <typename SampleType>
+    struct Coefficients
+    {
+        SampleType b0 = 1;
+        SampleType b1 = 0;
+        SampleType b2 = 0;
+        SampleType a1 = 0;
+        SampleType a2 = 0;
+
+        static Coefficients fromFilter (const FilterBase<SampleType>& filter) noexcept
+        {
+            using Filter = FilterBase<SampleType>;
+
+            return { filter.coeffs[Filter::b0], filter.coeffs[Filter::b1], filter.coeffs[Filter::b2],
+                     filter.coeffs[Filter::a1], filter.coeffs[Filter::a2] };
+        }
+    };
+}
+
+using RBJCoefficients = RBJ::Coefficients<float>;
+
+// FilterType's coefficients for one sample rate and order, computed once by prepare() on a grid of cutoffs
+// stepsPerOctave apart from lowestFrequency up to just under nyquist. get() interpolates between the two grid
+// points either side of fc using only fastLog2, so filters can be retuned from the audio thread every frame.
+// Interpolated filters stay stable, the stable (a1, a2) region is a triangle so any mix of two stable biquads is in it.
+template <typename FilterType>
+class RBJCoefficientCache
+{
+public:
+    using SampleType = typename FilterType::ValueType;
+    using Coefficients = RBJ::Coefficients<SampleType>;
+
+    static constexpr int stepsPerOctave = 48;
+    static constexpr int numOctaves = 10;
+    static constexpr int gridSize = stepsPerOctave * numOctaves + 1;
+    static constexpr float lowestFrequency = 20.0f;
+
+    // Off the audio thread, only recomputes when the sample rate or order differ from the last call
+    void prepare (float sampleRate, int filterOrder)
+    {
+        if (sampleRate == fs && filterOrder == order)
+            return;
+
+        fs = sampleRate;
+        order = filterOrder;
+
+        const float highestFrequency = fs * 0.45f;
+        lastIndex = juce::jlimit (1, gridSize - 1, static_cast<int> (std::log2 (highestFrequency / lowestFrequency) * stepsPerOctave));
+
+        for (int i = 0; i <= lastIndex; ++i)
+        {
+            FilterType filter;
+            filter.calculateCoeffs (lowestFrequency * std::exp2 (static_cast<float> (i) / stepsPerOctave), fs, order);
+            grid[static_cast<size_t> (i)] = Coefficients::fromFilter (filter);
+        }
+    }
+
+    // fc outside the grid is clamped to its first or last point
+    Coefficients get (float fc) const noexcept
+    {
+        const float position = Utils::fastLog2 (juce::jmax (fc, lowestFrequency) / lowestFrequency) * stepsPerOctave;
+        const int index = juce::jmin (static_cast<int> (position), lastIndex - 1);
+        const auto frac = static_cast<SampleType> (juce::jmin (1.0f, position - static_cast<float> (index)));
+
+        const auto& lower = grid[static_cast<size_t> (index)];
+        const auto& upper = grid[static_cast<size_t> (index + 1)];
+
+        return { lower.b0 + frac * (upper.b0 - lower.b0),
+                 lower.b1 + frac * (upper.b1 - lower.b1),
+                 lower.b2 + frac * (upper.b2 - lower.b2),
+                 lower.a1 + frac * (upper.a1 - lower.a1),
+                 lower.a2 + frac * (upper.a2 - lower.a2) };
+    }
+
+private:
+    std::array<Coefficients, gridSize> grid;
+    float fs = 0.0f;
+    int order = 0;
+    int lastIndex = 1;
+};
@@ -0,0 +1,142 @@
+#pragma once
+#include "RBJFilters.h"
+#include "RBJCoefficientCache.h"
+
+// numLanes independent chains of numStages transposed direct form II biquads run side by side, one lane per
+// SIMD element. Samples are interleaved [sample][lane] like MultiChannelPitchDetectionFX's buffers, and every lane
+// of every stage has its own coefficients, so one bank can be six strings through the same band limit or one
+// signal through a band-pass per target note. Coefficients come from any RBJ filter, the formulas stay in RBJFilters.
+// Like BiquadCascade the audio is float and SampleType is the precision of the coefficients and state, a double bank
+// fits half as many lanes in a register. Blocks run with flush to zero set and snap the state to zero at the end.
+
+template <int numLanes, int numStages = 1, typename SampleType = float>
+class RBJFilterBank
+{
+public:
+    static_assert (numLanes > 0 && numStages > 0, "a bank needs at least one lane and one stage");
+
+    using Coefficients = RBJ::Coefficients<SampleType>;
+    using Filter = RBJ::FilterBase<SampleType>;
+
+    RBJFilterBank()
+    {
+        for (int stage = 0; stage < numStages; ++stage)
+            for (int lane = 0; lane < numLanes; ++lane)
+                setCoeffs (lane, stage, Coefficients {});
+
+        reset();
+    }
+
+    void setCoeffs (int lane, int stage, const Filter& filter) noexcept
+    {
+        setCoeffs (lane, stage, Coefficients::fromFilter (filter));
+    }
+
+    void setCoeffs (int lane, int stage, const Coefficients& coefficients) noexcept
+    {
+        jassert (lane >= 0 && lane < numLanes && stage >= 0 && stage < numStages);
+
+        const auto l = static_cast<size_t> (lane);
+        auto& c = data.coeffs[static_cast<size_t> (stage)];
+        c[b0][l] = coefficients.b0;
+        c[b1][l] = coefficients.b1;
+        c[b2][l] = coefficients.b2;
+        c[a1][l] = coefficients.a1;
+        c[a2][l] = coefficients.a2;
+    }
+
+    // Same coefficients on every lane of a stage
+    void setCoeffs (int stage, const Filter& filter) noexcept
+    {
+        for (int lane = 0; lane < numLanes; ++lane)
+            setCoeffs (lane, stage, filter);
+    }
+
+    // Clears the filter state, coefficients are kept
+    void reset() noexcept
+    {
+        memset (data.state, 0, sizeof (data.state));
+    }
+
+    // input and output hold numSamples * numLanes interleaved samples and may be the same buffer
+    void process (const float* input, float* output, int numSamples) noexcept
+    {
+        juce::ScopedNoDenormals noDenormals;
+        runStage<false> (0, input, output, numSamples);
+
+        for (int stage = 1; stage < numStages; ++stage)
+            runStage<false> (stage, output, output, numSamples);
+    }
+
+    void process (float* inputOutput, int numSamples) noexcept
+    {
+        process (inputOutput, inputOutput, numSamples);
+    }
+
+    // One mono signal into every lane, output is interleaved, e.g. a band-pass per note over a single pickup
+    void processMono (const float* input, float* output, int numSamples) noexcept
+    {
+        juce::ScopedNoDenormals noDenormals;
+        runStage<true> (0, input, output, numSamples);
+
+        for (int stage = 1; stage < numStages; ++stage)
+            runStage<false> (stage, output, output, numSamples);
+    }
+
+private:
+    enum coeffs { b0, b1, b2, a1, a2, NUMCOEFFS };
+    enum state { s1, s2, NUMSTATE };
+
+    // array extents, lane and sample offsets are size_t so indexing never mixes signedness
+    static constexpr size_t laneCount = static_cast<size_t> (numLanes);
+    static constexpr size_t stageCount = static_cast<size_t> (numStages);
+
+    // coefficient major so each coefficient of a stage is one register of lanes
+    struct alignas (64) Data
+    {
+        SampleType coeffs[stageCount][NUMCOEFFS][laneCount];
+        SampleType state[stageCount][NUMSTATE][laneCount];
+    };
+
+    // A stage at a time over the whole block, the lane loop has no dependencies between iterations and a constant
+    // trip count so it compiles to straight SIMD, the recurrence only runs along samples
+    template <bool monoInput>
+    void runStage (int stage, const float* input, float* output, int numSamples) noexcept
+    {
+        const auto& c = data.coeffs[static_cast<size_t> (stage)];
+        auto& stageState = data.state[static_cast<size_t> (stage)];
+        alignas (64) SampleType z1[laneCount];
+        alignas (64) SampleType z2[laneCount];
+
+        memcpy (z1, stageState[s1], sizeof (z1));
+        memcpy (z2, stageState[s2], sizeof (z2));
+
+        for (size_t i = 0; i < static_cast<size_t> (numSamples); ++i)
+        {
+            alignas (64) SampleType in[laneCount];
+
+            for (size_t lane = 0; lane < laneCount; ++lane)
+                in[lane] = monoInput ? input[i] : input[i * laneCount + lane];
+
+            float* out = output + i * laneCount;
+
+            for (size_t lane = 0; lane < laneCount; ++lane)
+            {
+                const SampleType y = c[b0][lane] * in[lane] + z1[lane];
+
+                z1[lane] = (c[b1][lane] * in[lane] + z2[lane]) - c[a1][lane] * y;
+                z2[lane] = c[b2][lane] * in[lane] - c[a2][lane] * y;
+
+                out[lane] = static_cast<float> (y);
+            }
+        }
+
+        for (size_t lane = 0; lane < laneCount; ++lane)
+        {
+            stageState[s1][lane] = RBJ::snapToZero (z1[lane]);
+            stageState[s2][lane] = RBJ::snapToZero (z2[lane]);
+        }
+    }
+
+    Data data;
+};
@@ -1,55 +1,91 @@
 #include "RBJFilters.h"
 #include <cmath>
 
-RBJFilter_base::RBJFilter_base()
+template <typename SampleType>
+RBJ::FilterBase<SampleType>::FilterBase()
 {
     freqc = 0.0f;
     q     = 0.0f;
     norm  = 0.0f;
 
-    for (float& coeff : coeffs)
+    for (SampleType& coeff : coeffs)
         coeff = 0.0f;
 
-    for (int i = 0; i < 3; ++i)
+    for (SampleType& value : state)
+        value = 0.0f;
+}
+
+template <typename SampleType>
+RBJ::FilterBase<SampleType>::~FilterBase() {}
+
+// Transposed direct form II, the two state variables stay in locals for the whole block. The bracketing keeps
+// the feedback multiply last so only one multiply and two adds sit on the sample to sample dependency.
+template <typename SampleType>
+void RBJ::FilterBase<SampleType>::process (const SampleType* input, SampleType* output, int numSamples) noexcept
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    const SampleType cb0 = coeffs[b0];
+    const SampleType cb1 = coeffs[b1];
+    const SampleType cb2 = coeffs[b2];
+    const SampleType ca1 = coeffs[a1];
+    const SampleType ca2 = coeffs[a2];
+
+    SampleType z1 = state[s1];
+    SampleType z2 = state[s2];
+
+    for (int i = 0; i < numSamples; ++i)
     {
-        y[i] = 0.0f;
-        x[i] = 0.0f;
+        const SampleType in = input[i];
+        const SampleType out = cb0 * in + z1;
+
+        z1 = (cb1 * in + z2) - ca1 * out;
+        z2 = cb2 * in - ca2 * out;
+
+        output[i] = out;
     }
+
+    state[s1] = snapToZero (z1);
+    state[s2] = snapToZero (z2);
 }
 
-RBJFilter_base::~RBJFilter_base() {}
+template <typename SampleType>
+void RBJ::FilterBase<SampleType>::process (SampleType* inputOutput, int numSamples) noexcept
+{
+    process (inputOutput, inputOutput, numSamples);
+}
 
 // ===================== LPF =====================
 
-LPF::LPF()
+template <typename SampleType>
+RBJ::LPF<SampleType>::LPF()
 {
     freqc = 0.0f;
     q  = 0.0f;
     norm = 0.0f;
 
-    for (float& coeff : coeffs)
+    for (SampleType& coeff : coeffs)
         coeff = 0.0f;
 
-    for (int i = 0; i < 3; ++i)
-    {
-        y[i] = 0.0f;
-        x[i] = 0.0f;
-    }
+    for (SampleType& value : state)
+        value = 0.0f;
 }
 
-float LPF::calculateBandwidth (int order)
+template <typename SampleType>
+SampleType RBJ::LPF<SampleType>::calculateBandwidth (int order)
 {
     jlimit (1, 10, order);
-    return std::sqrt (std::powf (10.0f, (static_cast<float> (order) * 3.0f) * (1.0f / 20.0f)));
+    return std::sqrt (std::pow (static_cast<SampleType> (10), (static_cast<float> (order) * 3.0f) * (1.0f / 20.0f)));
 }
 
-void LPF::calculateCoeffs (float fc, float fs, int)
+template <typename SampleType>
+void RBJ::LPF<SampleType>::calculateCoeffs (float fc, float fs, int)
 {
 
     fc = jlimit (20.0f, 24000.0f, fc);
-    const float w = 2.0f * static_cast<float> (juce::MathConstants<float>::pi) * (fc / fs);
-    const float c = cos (w);
-    const float a = std::sin (w) / (2.0f * 0.707f);
+    const SampleType w = 2.0f * juce::MathConstants<SampleType>::pi * (static_cast<SampleType> (fc) / static_cast<SampleType> (fs));
+    const SampleType c = cos (w);
+    const SampleType a = std::sin (w) / (2.0f * 0.707f);
     norm = 1.0f / (1.0f + a);
 
     coeffs[LPF::a0] = (1.0f + a)          * norm;
@@ -60,54 +96,49 @@ void LPF::calculateCoeffs (float fc, float fs, int)
     coeffs[LPF::b2] = coeffs[LPF::b0];
 }
 
-void LPF::process (float& input)
+template <typename SampleType>
+void RBJ::LPF<SampleType>::process (SampleType& input)
 {
-    x[2] = x[1];
-    x[1] = x[0];
-    x[0] = input;
-    y[2] = y[1];
-    y[1] = y[0];
+    const SampleType in = input;
+    const SampleType out = coeffs[LPF::b0] * in + state[LPF::s1];
 
-    y[0] = coeffs[LPF::b0] * x[0]
-         + coeffs[LPF::b1] * x[1]
-         + coeffs[LPF::b2] * x[2]
-         - coeffs[LPF::a1] * y[1]
-         - coeffs[LPF::a2] * y[2];
+    state[LPF::s1] = (coeffs[LPF::b1] * in + state[LPF::s2]) - coeffs[LPF::a1] * out;
+    state[LPF::s2] = coeffs[LPF::b2] * in - coeffs[LPF::a2] * out;
 
-    input = y[0];
+    input = out;
 }
 
 
 // ===================== HPF =====================
 
-HPF::HPF()
+template <typename SampleType>
+RBJ::HPF<SampleType>::HPF()
 {
     freqc = 0.0f;
     q     = 0.0f;
     norm  = 0.0f;
 
-    for (int i = 0; i < RBJFilter_base::NUMCOEFFS; ++i)
+    for (int i = 0; i < FilterBase<SampleType>::NUMCOEFFS; ++i)
         coeffs[i] = 0.0f;
 
-    for (int i = 0; i < 3; ++i)
-    {
-        y[i] = 0.0f;
-        x[i] = 0.0f;
-    }
+    for (SampleType& value : state)
+        value = 0.0f;
 }
 
-float HPF::calculateBandwidth (int)
+template <typename SampleType>
+SampleType RBJ::HPF<SampleType>::calculateBandwidth (int)
 {
     return 0.0;
 }
 
-void HPF::calculateCoeffs (float fc, float fs, int)
+template <typename SampleType>
+void RBJ::HPF<SampleType>::calculateCoeffs (float fc, float fs, int)
 {
     fc = jlimit (1.0f, 20000.0f, fc);
 
-    const float w = 2.0f * static_cast<float> (juce::MathConstants<float>::pi) * (fc / fs);
-    const float c = cos(w);
-    const float a = std::sin(w) / (2.0f * 0.707f);
+    const SampleType w = 2.0f * juce::MathConstants<SampleType>::pi * (static_cast<SampleType> (fc) / static_cast<SampleType> (fs));
+    const SampleType c = cos(w);
+    const SampleType a = std::sin(w) / (2.0f * 0.707f);
 
     norm = 1.0f / (1.0f + a);
 
@@ -119,58 +150,51 @@ void HPF::calculateCoeffs (float fc, float fs, int)
     coeffs[HPF::b2] = coeffs[HPF::b0];
 }
 
-void HPF::process (float& input)
+template <typename SampleType>
+void RBJ::HPF<SampleType>::process (SampleType& input)
 {
-    x[0] = input;
+    const SampleType in = input;
+    const SampleType out = coeffs[HPF::b0] * in + state[HPF::s1];
 
-    y[0] = coeffs[HPF::b0] * x[0]
-         + coeffs[HPF::b1] * x[1]
-         + coeffs[HPF::b2] * x[2]
-         - coeffs[HPF::a1] * y[1]
-         - coeffs[HPF::a2] * y[2];
+    state[HPF::s1] = (coeffs[HPF::b1] * in + state[HPF::s2]) - coeffs[HPF::a1] * out;
+    state[HPF::s2] = coeffs[HPF::b2] * in - coeffs[HPF::a2] * out;
 
-    x[2] = x[1];
-    x[1] = x[0];
-
-    y[2] = y[1];
-    y[1] = y[0];
-
-    input = y[0];
+    input = out;
 }
 
 
 // ===================== Peak =====================
 
-Peak::Peak()
+template <typename SampleType>
+RBJ::Peak<SampleType>::Peak()
 {
     freqc = 0.0f;
     q  = 0.0f;
     norm = 0.0f;
 
-    for (int i = 0; i < RBJFilter_base::NUMCOEFFS; ++i)
+    for (int i = 0; i < FilterBase<SampleType>::NUMCOEFFS; ++i)
         coeffs[i] = 0.0f;
 
-    for (int i = 0; i < 3; ++i)
-    {
-        y[i] = 0.0f;
-        x[i] = 0.0f;
-    }
+    for (SampleType& value : state)
+        value = 0.0f;
 }
 
-float Peak::calculateBandwidth (int order)
+template <typename SampleType>
+SampleType RBJ::Peak<SampleType>::calculateBandwidth (int order)
 {
     jlimit(-24, 24, order);
-    return std::powf (10.0f, float(order) / 40.0f);
+    return std::pow (static_cast<SampleType> (10), float(order) / 40.0f);
 }
 
-void Peak::calculateCoeffs (float fc, float fs, int order)
+template <typename SampleType>
+void RBJ::Peak<SampleType>::calculateCoeffs (float fc, float fs, int order)
 {
-    const float A = calculateBandwidth (order);
-    const float w = 2.0f * static_cast<float> (juce::MathConstants<float>::pi) * (fc / fs);
-    const float c = cos(w);
-    const float s = sin(w);
-    const float BW = 3.0f / 2.0f;
-    const float a = s * std::sinh (std::log (2.0f) / 2.0f * BW * w / s);
+    const SampleType A = calculateBandwidth (order);
+    const SampleType w = 2.0f * juce::MathConstants<SampleType>::pi * (static_cast<SampleType> (fc) / static_cast<SampleType> (fs));
+    const SampleType c = cos(w);
+    const SampleType s = sin(w);
+    const SampleType BW = 3.0f / 2.0f;
+    const SampleType a = s * std::sinh (std::log (static_cast<SampleType> (2)) / 2.0f * BW * w / s);
 
     norm = 1.0f / (1.0f + a / A);
 
@@ -182,58 +206,51 @@ void Peak::calculateCoeffs (float fc, float fs, int order)
     coeffs[Peak::b2] = (1.0f - a * A)   * norm;
 }
 
-void Peak::process (float& input)
+template <typename SampleType>
+void RBJ::Peak<SampleType>::process (SampleType& input)
 {
-    x[0] = input;
-
-    y[0] = coeffs[Peak::b0] * x[0]
-         + coeffs[Peak::b1] * x[1]
-         + coeffs[Peak::b2] * x[2]
-         - coeffs[Peak::a1] * y[1]
-         - coeffs[Peak::a2] * y[2];
-
-    x[2] = x[1];
-    x[1] = x[0];
+    const SampleType in = input;
+    const SampleType out = coeffs[Peak::b0] * in + state[Peak::s1];
 
-    y[2] = y[1];
-    y[1] = y[0];
+    state[Peak::s1] = (coeffs[Peak::b1] * in + state[Peak::s2]) - coeffs[Peak::a1] * out;
+    state[Peak::s2] = coeffs[Peak::b2] * in - coeffs[Peak::a2] * out;
 
-    input = y[0];
+    input = out;
 }
 
 // ===================== BPF =====================
 
-BPF::BPF()
+template <typename SampleType>
+RBJ::BPF<SampleType>::BPF()
 {
     freqc = 0.0f;
     q     = 0.0f;
     norm  = 0.0f;
 
-    for (int i = 0; i < RBJFilter_base::NUMCOEFFS; ++i)
+    for (int i = 0; i < FilterBase<SampleType>::NUMCOEFFS; ++i)
         coeffs[i] = 0.0f;
 
-    for (int i = 0; i < 3; ++i)
-    {
-        y[i] = 0.0f;
-        x[i] = 0.0f;
-    }
+    for (SampleType& value : state)
+        value = 0.0f;
 }
 
-float BPF::calculateBandwidth (int order)
+template <typename SampleType>
+SampleType RBJ::BPF<SampleType>::calculateBandwidth (int order)
 {
     jlimit(-24, 24, order);
-    return  std::powf (10.0f, float(order) / 40.0f);
+    return  std::pow (static_cast<SampleType> (10), float(order) / 40.0f);
 }
 
-void BPF::calculateCoeffs (float fc, float fs, int)
+template <typename SampleType>
+void RBJ::BPF<SampleType>::calculateCoeffs (float fc, float fs, int)
 {
-    const float gain = 1.0f;
-    const float Q = 0.707f;
-    const float w = 2.0f * static_cast<float> (juce::MathConstants<float>::pi) * (fc / fs);
-    const float c = cos(w);
-    const float s = sin(w);
-    const float BW = gain / 2.0f;
-    const float a = s * std::sinh (std::log (2.0f) / 2.0f * BW * w / s);
+    const SampleType gain = 1.0f;
+    const SampleType Q = 0.707f;
+    const SampleType w = 2.0f * juce::MathConstants<SampleType>::pi * (static_cast<SampleType> (fc) / static_cast<SampleType> (fs));
+    const SampleType c = cos(w);
+    const SampleType s = sin(w);
+    const SampleType BW = gain / 2.0f;
+    const SampleType a = s * std::sinh (std::log (static_cast<SampleType> (2)) / 2.0f * BW * w / s);
 
     norm = 1.0f / (1.0f + a);
 
@@ -245,58 +262,51 @@ void BPF::calculateCoeffs (float fc, float fs, int)
     coeffs[BPF::b2] = (-Q * a)     * norm;
 }
 
-void BPF::process (float& input)
+template <typename SampleType>
+void RBJ::BPF<SampleType>::process (SampleType& input)
 {
-    x[0] = input;
-
-    y[0] = coeffs[BPF::b0] * x[0]
-         + coeffs[BPF::b1] * x[1]
-         + coeffs[BPF::b2] * x[2]
-         - coeffs[BPF::a1] * y[1]
-         - coeffs[BPF::a2] * y[2];
+    const SampleType in = input;
+    const SampleType out = coeffs[BPF::b0] * in + state[BPF::s1];
 
-    x[2] = x[1];
-    x[1] = x[0];
+    state[BPF::s1] = (coeffs[BPF::b1] * in + state[BPF::s2]) - coeffs[BPF::a1] * out;
+    state[BPF::s2] = coeffs[BPF::b2] * in - coeffs[BPF::a2] * out;
 
-    y[2] = y[1];
-    y[1] = y[0];
-
-    input = y[0];
+    input = out;
 }
 
 
 // ===================== BPFcQ =====================
 
-BPFcQ::BPFcQ()
+template <typename SampleType>
+RBJ::BPFcQ<SampleType>::BPFcQ()
 {
     freqc = 0.0f;
     q     = 0.0f;
     norm  = 0.0f;
 
-    for (int i = 0; i < RBJFilter_base::NUMCOEFFS; ++i)
+    for (int i = 0; i < FilterBase<SampleType>::NUMCOEFFS; ++i)
         coeffs[i] = 0.0f;
 
-    for (int i = 0; i < 3; ++i)
-    {
-        y[i] = 0.0f;
-        x[i] = 0.0f;
-    }
+    for (SampleType& value : state)
+        value = 0.0f;
 }
 
-float BPFcQ::calculateBandwidth (int order)
+template <typename SampleType>
+SampleType RBJ::BPFcQ<SampleType>::calculateBandwidth (int order)
 {
     jlimit(-24, 24, order);
-    return  std::powf (10.0f, float(order) / 40.0f);
+    return  std::pow (static_cast<SampleType> (10), float(order) / 40.0f);
 }
 
-void BPFcQ::calculateCoeffs (float fc, float fs, int)
+template <typename SampleType>
+void RBJ::BPFcQ<SampleType>::calculateCoeffs (float fc, float fs, int)
 {
-    const float gain = 1.0f;
-    const float w = 2.0f * static_cast<float> (juce::MathConstants<float>::pi) * (fc / fs);
-    const float c = cos(w);
-    const float s = sin(w);
-    const float BW = gain / 2.0f;
-    const float a = s * std::sinh (std::log (2.0f) / 2.0f * BW * w / s);
+    const SampleType gain = 1.0f;
+    const SampleType w = 2.0f * juce::MathConstants<SampleType>::pi * (static_cast<SampleType> (fc) / static_cast<SampleType> (fs));
+    const SampleType c = cos(w);
+    const SampleType s = sin(w);
+    const SampleType BW = gain / 2.0f;
+    const SampleType a = s * std::sinh (std::log (static_cast<SampleType> (2)) / 2.0f * BW * w / s);
 
     norm = 1.0f / (1.0f + a);
 
@@ -308,58 +318,51 @@ void BPFcQ::calculateCoeffs (float fc, float fs, int)
     coeffs[BPFcQ::b2] = -a           * norm;
 }
 
-void BPFcQ::process (float& input)
+template <typename SampleType>
+void RBJ::BPFcQ<SampleType>::process (SampleType& input)
 {
-    x[0] = input;
+    const SampleType in = input;
+    const SampleType out = coeffs[BPFcQ::b0] * in + state[BPFcQ::s1];
 
-    y[0] = coeffs[BPFcQ::b0] * x[0]
-         + coeffs[BPFcQ::b1] * x[1]
-         + coeffs[BPFcQ::b2] * x[2]
-         - coeffs[BPFcQ::a1] * y[1]
-         - coeffs[BPFcQ::a2] * y[2];
+    state[BPFcQ::s1] = (coeffs[BPFcQ::b1] * in + state[BPFcQ::s2]) - coeffs[BPFcQ::a1] * out;
+    state[BPFcQ::s2] = coeffs[BPFcQ::b2] * in - coeffs[BPFcQ::a2] * out;
 
-    x[2] = x[1];
-    x[1] = x[0];
-
-    y[2] = y[1];
-    y[1] = y[0];
-
-    input = y[0];
+    input = out;
 }
 
 
 // ===================== BPFcQ =====================
 
-Notch::Notch()
+template <typename SampleType>
+RBJ::Notch<SampleType>::Notch()
 {
     freqc = 0.0f;
     q     = 0.0f;
     norm  = 0.0f;
 
-    for (int i = 0; i < RBJFilter_base::NUMCOEFFS; ++i)
+    for (int i = 0; i < FilterBase<SampleType>::NUMCOEFFS; ++i)
         coeffs[i] = 0.0f;
 
-    for (int i = 0; i < 3; ++i)
-    {
-        y[i] = 0.0f;
-        x[i] = 0.0f;
-    }
+    for (SampleType& value : state)
+        value = 0.0f;
 }
 
-float Notch::calculateBandwidth (int order)
+template <typename SampleType>
+SampleType RBJ::Notch<SampleType>::calculateBandwidth (int order)
 {
     jlimit(-24, 24, order);
-    return  std::powf (10.0f, float(order) / 40.0f);
+    return  std::pow (static_cast<SampleType> (10), float(order) / 40.0f);
 }
 
-void Notch::calculateCoeffs (float fc, float fs, int)
+template <typename SampleType>
+void RBJ::Notch<SampleType>::calculateCoeffs (float fc, float fs, int)
 {
-    const float gain = 3.0f;
-    const float w = 2.0f * static_cast<float> (juce::MathConstants<float>::pi) * (fc / fs);
-    const float c = cos(w);
-    const float s = sin(w);
-    const float BW = gain / 2.0f;
-    const float a = s * std::sinh (std::log (2.0f) / 2.0f * BW * w / s);
+    const SampleType gain = 3.0f;
+    const SampleType w = 2.0f * juce::MathConstants<SampleType>::pi * (static_cast<SampleType> (fc) / static_cast<SampleType> (fs));
+    const SampleType c = cos(w);
+    const SampleType s = sin(w);
+    const SampleType BW = gain / 2.0f;
+    const SampleType a = s * std::sinh (std::log (static_cast<SampleType> (2)) / 2.0f * BW * w / s);
 
     norm = 1.0f / (1.0f + a);
 
@@ -371,57 +374,50 @@ void Notch::calculateCoeffs (float fc, float fs, int)
     coeffs[Notch::b2] = 1.0f         * norm;
 }
 
-void Notch::process (float& input)
+template <typename SampleType>
+void RBJ::Notch<SampleType>::process (SampleType& input)
 {
-    x[0] = input;
-
-    y[0] = coeffs[Notch::b0] * x[0]
-         + coeffs[Notch::b1] * x[1]
-         + coeffs[Notch::b2] * x[2]
-         - coeffs[Notch::a1] * y[1]
-         - coeffs[Notch::a2] * y[2];
-
-    x[2] = x[1];
-    x[1] = x[0];
+    const SampleType in = input;
+    const SampleType out = coeffs[Notch::b0] * in + state[Notch::s1];
 
-    y[2] = y[1];
-    y[1] = y[0];
+    state[Notch::s1] = (coeffs[Notch::b1] * in + state[Notch::s2]) - coeffs[Notch::a1] * out;
+    state[Notch::s2] = coeffs[Notch::b2] * in - coeffs[Notch::a2] * out;
 
-    input = y[0];
+    input = out;
 }
 
 // ===================== APF =====================
 
-APF::APF()
+template <typename SampleType>
+RBJ::APF<SampleType>::APF()
 {
     freqc = 0.0f;
     q     = 0.0f;
     norm  = 0.0f;
 
-    for (int i = 0; i < RBJFilter_base::NUMCOEFFS; ++i)
+    for (int i = 0; i < FilterBase<SampleType>::NUMCOEFFS; ++i)
         coeffs[i] = 0.0f;
 
-    for (int i = 0; i < 3; ++i)
-    {
-        y[i] = 0.0f;
-        x[i] = 0.0f;
-    }
+    for (SampleType& value : state)
+        value = 0.0f;
 }
 
-float APF::calculateBandwidth (int order)
+template <typename SampleType>
+SampleType RBJ::APF<SampleType>::calculateBandwidth (int order)
 {
     jlimit(-24, 24, order);
-    return  std::powf (10.0f, float(order) / 40.0f);
+    return  std::pow (static_cast<SampleType> (10), float(order) / 40.0f);
 }
 
-void APF::calculateCoeffs (float fc, float fs, int)
+template <typename SampleType>
+void RBJ::APF<SampleType>::calculateCoeffs (float fc, float fs, int)
 {
-    const float gain = 12.0f;
-    const float w = 2.0f * static_cast<float> (juce::MathConstants<float>::pi) * (fc / fs);
-    const float c = cos(w);
-    const float s = sin(w);
-    const float BW = gain / 2.0f;
-    const float a = s * std::sinh (std::log (2.0f) / 2.0f * BW * w / s);
+    const SampleType gain = 12.0f;
+    const SampleType w = 2.0f * juce::MathConstants<SampleType>::pi * (static_cast<SampleType> (fc) / static_cast<SampleType> (fs));
+    const SampleType c = cos(w);
+    const SampleType s = sin(w);
+    const SampleType BW = gain / 2.0f;
+    const SampleType a = s * std::sinh (std::log (static_cast<SampleType> (2)) / 2.0f * BW * w / s);
 
     norm = 1.0f / (1.0f + a);
 
@@ -433,23 +429,16 @@ void APF::calculateCoeffs (float fc, float fs, int)
     coeffs[APF::b2] = (1.0f + a)   * norm;
 }
 
-void APF::process (float& input)
+template <typename SampleType>
+void RBJ::APF<SampleType>::process (SampleType& input)
 {
-    x[0] = input;
-
-    y[0] = coeffs[APF::b0] * x[0]
-         + coeffs[APF::b1] * x[1]
-         + coeffs[APF::b2] * x[2]
-         - coeffs[APF::a1] * y[1]
-         - coeffs[APF::a2] * y[2];
+    const SampleType in = input;
+    const SampleType out = coeffs[APF::b0] * in + state[APF::s1];
 
-    x[2] = x[1];
-    x[1] = x[0];
+    state[APF::s1] = (coeffs[APF::b1] * in + state[APF::s2]) - coeffs[APF::a1] * out;
+    state[APF::s2] = coeffs[APF::b2] * in - coeffs[APF::a2] * out;
 
-    y[2] = y[1];
-    y[1] = y[0];
-
-    input = y[0];
+    input = out;
 }
 
 
@@ -457,33 +446,33 @@ void APF::process (float& input)
 
 // ===================== LowShelf =====================
 
-LowShelf::LowShelf()
+template <typename SampleType>
+RBJ::LowShelf<SampleType>::LowShelf()
 {
     freqc = 0.0f;
     q     = 0.0f;
     norm  = 0.0f;
 
-    for (int i = 0; i < RBJFilter_base::NUMCOEFFS; ++i)
+    for (int i = 0; i < FilterBase<SampleType>::NUMCOEFFS; ++i)
         coeffs[i] = 0.0f;
 
-    for (int i = 0; i < 3; ++i)
-    {
-        y[i] = 0.0f;
-        x[i] = 0.0f;
-    }
+    for (SampleType& value : state)
+        value = 0.0f;
 }
 
-float LowShelf::calculateBandwidth (int order)
+template <typename SampleType>
+SampleType RBJ::LowShelf<SampleType>::calculateBandwidth (int order)
 {
     jlimit(-24, 24, order);
-    return  std::powf (10.0f, float(order) / 40.0f);
+    return  std::pow (static_cast<SampleType> (10), float(order) / 40.0f);
 }
 
-void LowShelf::calculateCoeffs (float fc, float fs, int)
+template <typename SampleType>
+void RBJ::LowShelf<SampleType>::calculateCoeffs (float fc, float fs, int)
 {
     const auto gain = -12.0f;
-    const auto A = std::powf (10.0f, gain / 40.0f);
-    const auto w = 2.0f * static_cast<float> (juce::MathConstants<float>::pi) * (fc / fs);
+    const auto A = std::pow (static_cast<SampleType> (10), gain / 40.0f);
+    const auto w = 2.0f * juce::MathConstants<SampleType>::pi * (static_cast<SampleType> (fc) / static_cast<SampleType> (fs));
     const auto c = cos(w);
     const auto s = sin(w);
     const auto S = 1.0f;
@@ -500,60 +489,53 @@ void LowShelf::calculateCoeffs (float fc, float fs, int)
     coeffs[LowShelf::b2] = (A * ((A + 1.0f) + (A - 1.0f) * c - 2.0f * std::sqrt(A) * a)) * norm;
 }
 
-void LowShelf::process (float& input)
+template <typename SampleType>
+void RBJ::LowShelf<SampleType>::process (SampleType& input)
 {
-    x[0] = input;
+    const SampleType in = input;
+    const SampleType out = coeffs[LowShelf::b0] * in + state[LowShelf::s1];
 
-    y[0] = coeffs[LowShelf::b0] * x[0]
-         + coeffs[LowShelf::b1] * x[1]
-         + coeffs[LowShelf::b2] * x[2]
-         - coeffs[LowShelf::a1] * y[1]
-         - coeffs[LowShelf::a2] * y[2];
+    state[LowShelf::s1] = (coeffs[LowShelf::b1] * in + state[LowShelf::s2]) - coeffs[LowShelf::a1] * out;
+    state[LowShelf::s2] = coeffs[LowShelf::b2] * in - coeffs[LowShelf::a2] * out;
 
-    x[2] = x[1];
-    x[1] = x[0];
-
-    y[2] = y[1];
-    y[1] = y[0];
-
-    input = y[0];
+    input = out;
 }
 
 
 
 // ===================== HighShelf =====================
 
-HighShelf::HighShelf()
+template <typename SampleType>
+RBJ::HighShelf<SampleType>::HighShelf()
 {
     freqc = 0.0f;
     q     = 0.0f;
     norm  = 0.0f;
 
-    for (int i = 0; i < RBJFilter_base::NUMCOEFFS; ++i)
+    for (int i = 0; i < FilterBase<SampleType>::NUMCOEFFS; ++i)
         coeffs[i] = 0.0f;
 
-    for (int i = 0; i < 3; ++i)
-    {
-        y[i] = 0.0f;
-        x[i] = 0.0f;
-    }
+    for (SampleType& value : state)
+        value = 0.0f;
 }
 
-float HighShelf::calculateBandwidth (int order)
+template <typename SampleType>
+SampleType RBJ::HighShelf<SampleType>::calculateBandwidth (int order)
 {
     jlimit(-24, 24, order);
-    return  std::powf (10.0f, float (order) / 40.0f);
+    return  std::pow (static_cast<SampleType> (10), float (order) / 40.0f);
 }
 
-void HighShelf::calculateCoeffs (float fc, float fs, int)
+template <typename SampleType>
+void RBJ::HighShelf<SampleType>::calculateCoeffs (float fc, float fs, int)
 {
-    const float gain = -12.0f;
-    const float A = std::powf (10.0f, gain / 40.0f);
-    const float w = 2.0f * static_cast<float> (juce::MathConstants<float>::pi) * (fc / fs);
-    const float c = cos(w);
-    const float s = sin(w);
-    const float S = 1.0f;
-    const float a = (s / 2.0f) * std::sqrt((A + (1.0f / A)) * ((1.0f / S) - 1.0f) + 2.0f);
+    const SampleType gain = -12.0f;
+    const SampleType A = std::pow (static_cast<SampleType> (10), gain / 40.0f);
+    const SampleType w = 2.0f * juce::MathConstants<SampleType>::pi * (static_cast<SampleType> (fc) / static_cast<SampleType> (fs));
+    const SampleType c = cos(w);
+    const SampleType s = sin(w);
+    const SampleType S = 1.0f;
+    const SampleType a = (s / 2.0f) * std::sqrt((A + (1.0f / A)) * ((1.0f / S) - 1.0f) + 2.0f);
 
     norm = 1.0f / ((A + 1.0f) - (A - 1.0f) * c + 2.0f * std::sqrt(A) * a);
 
@@ -566,21 +548,37 @@ void HighShelf::calculateCoeffs (float fc, float fs, int)
     coeffs[HighShelf::b2] = (A * ((A + 1.0f) + (A - 1.0f) * c - 2.0f * std::sqrt(A) * a)) * norm;
 }
 
-void HighShelf::process (float& input)
-{
-    x[0] = input;
-
-    y[0] = coeffs[HighShelf::b0] * x[0]
-         + coeffs[HighShelf::b1] * x[1]
-         + coeffs[HighShelf::b2] * x[2]
-         - coeffs[HighShelf::a1] * y[1]
-         - coeffs[HighShelf::a2] * y[2];
-
-    x[2] = x[1];
-    x[1] = x[0];
-
-    y[2] = y[1];
-    y[1] = y[0];
-
-    input = y[0];
-}
\ No newline at end of file
+template <typename SampleType>
+void RBJ::HighShelf<SampleType>::process (SampleType& input)
+{
+    const SampleType in = input;
+    const SampleType out = coeffs[HighShelf::b0] * in + state[HighShelf::s1];
+
+    state[HighShelf::s1] = (coeffs[HighShelf::b1] * in + state[HighShelf::s2]) - coeffs[HighShelf::a1] * out;
+    state[HighShelf::s2] = coeffs[HighShelf::b2] * in - coeffs[HighShelf::a2] * out;
+
+    input = out;
+}
+
+// ===================== float and double =====================
+
+template class RBJ::FilterBase<float>;
+template class RBJ::FilterBase<double>;
+template class RBJ::LPF<float>;
+template class RBJ::LPF<double>;
+template class RBJ::HPF<float>;
+template class RBJ::HPF<double>;
+template class RBJ::Peak<float>;
+template class RBJ::Peak<double>;
+template class RBJ::BPF<float>;
+template class RBJ::BPF<double>;
+template class RBJ::BPFcQ<float>;
+template class RBJ::BPFcQ<double>;
+template class RBJ::Notch<float>;
+template class RBJ::Notch<double>;
+template class RBJ::APF<float>;
+template class RBJ::APF<double>;
+template class RBJ::LowShelf<float>;
+template class RBJ::LowShelf<double>;
+template class RBJ::HighShelf<float>;
+template class RBJ::HighShelf<double>;
@@ -2,166 +2,283 @@
 #include <JuceHeader.h>
 
 // RBJ EQ implementation https://www.w3.org/TR/audio-eq-cookbook/
-// TODO - change process function from taking a float& to block
-
-class RBJFilter_base
+// Transposed direct form II throughout, two state variables per biquad instead of the last two inputs and outputs.
+// Block process functions share one non-virtual biquad loop, the per-sample process is kept for single samples.
+// SampleType is the precision of the coefficients and the state, double keeps a low corner at a high sample rate
+// accurate where its poles crowd the unit circle. The block loop runs with flush to zero set and snaps the state
+// to zero at the end of every block, so a filter ringing out into silence costs the same as one fed with signal.
+// float and double are instantiated in RBJFilters.cpp, the unqualified names are the float filters.
+
+namespace RBJ
 {
-public:
-    enum coeffs {
-        a0,
-        a1,
-        a2,
-        b0,
-        b1,
-        b2,
-        NUMCOEFFS
+    // State this small is inaudible, clearing it keeps silence exactly zero on hosts or CPUs without flush to zero
+    template <typename SampleType>
+    inline SampleType snapToZero (SampleType value) noexcept
+    {
+        constexpr auto threshold = static_cast<SampleType> (1.0e-8);
+        return (value < -threshold || value > threshold) ? value : static_cast<SampleType> (0);
+    }
+
+    template <typename SampleType>
+    class FilterBase
+    {
+    public:
+        using ValueType = SampleType;
+
+        enum coeffs {
+            a0,
+            a1,
+            a2,
+            b0,
+            b1,
+            b2,
+            NUMCOEFFS
+        };
+
+        // transposed direct form II, s1 feeds the next output and s2 feeds s1
+        enum stateVariables {
+            s1,
+            s2,
+            NUMSTATE
+        };
+
+        FilterBase();
+        virtual ~FilterBase();
+
+        virtual SampleType calculateBandwidth (int order) = 0;
+        virtual void       calculateCoeffs (float fc, float fs, int order) = 0;
+        virtual void       process (SampleType& input) = 0;
+
+        void process (const SampleType* input, SampleType* output, int numSamples) noexcept;
+        void process (SampleType* inputOutput, int numSamples) noexcept;
+
+        float freqc = 100.0f;
+        float q = 0.707f;
+
+        SampleType norm;
+        SampleType coeffs[NUMCOEFFS];
+        SampleType state[NUMSTATE];
     };
 
-    RBJFilter_base();
-    virtual ~RBJFilter_base();
-
-    virtual float  calculateBandwidth (int order) = 0;
-    virtual void   calculateCoeffs (float fc, float fs, int order) = 0;
-    virtual void  process (float& input) = 0;
-
-    float freqc = 100.0f;
-    float q = 0.707f;
-
-    float norm;
-    float coeffs[NUMCOEFFS];
-    float y[3];
-    float x[3];
-};
-
-class LPF : public RBJFilter_base
-{
-public:
-
-    LPF();
 
-    void calculateCoeffs (float fc, float fs, int order) override;
-    void  process (float& input) override;
 
-private:
-    float calculateBandwidth (int order) override;
-};
+    template <typename SampleType>
+    class LPF : public FilterBase<SampleType>
+    {
+    public:
+        using FilterBase<SampleType>::coeffs;
+        using FilterBase<SampleType>::state;
+        using FilterBase<SampleType>::norm;
+        using FilterBase<SampleType>::freqc;
+        using FilterBase<SampleType>::q;
 
+        LPF();
 
+        void calculateCoeffs (float fc, float fs, int order) override;
+        void process (SampleType& input) override;
+        using FilterBase<SampleType>::process;
 
-class HPF : public RBJFilter_base
-{
-public:
-
-    HPF();
-
-    void calculateCoeffs (float fc, float fs, int order) override;
-    void  process (float& input) override;
-
-private:
-    float calculateBandwidth (int order) override;
-};
-
+    private:
+        SampleType calculateBandwidth (int order) override;
+    };
 
 
-class Peak : public RBJFilter_base
-{
-public:
+    template <typename SampleType>
+    class HPF : public FilterBase<SampleType>
+    {
+    public:
+        using FilterBase<SampleType>::coeffs;
+        using FilterBase<SampleType>::state;
+        using FilterBase<SampleType>::norm;
+        using FilterBase<SampleType>::freqc;
+        using FilterBase<SampleType>::q;
 
-    Peak();
+        HPF();
 
-    void calculateCoeffs (float fc, float fs, int order) override;
-    void  process (float& input) override;
+        void calculateCoeffs (float fc, float fs, int order) override;
+        void process (SampleType& input) override;
+        using FilterBase<SampleType>::process;
 
-private:
-    float calculateBandwidth (int order) override;
-};
+    private:
+        SampleType calculateBandwidth (int order) override;
+    };
 
 
+    template <typename SampleType>
+    class Peak : public FilterBase<SampleType>
+    {
+    public:
+        using FilterBase<SampleType>::coeffs;
+        using FilterBase<SampleType>::state;
+        using FilterBase<SampleType>::norm;
+        using FilterBase<SampleType>::freqc;
+        using FilterBase<SampleType>::q;
 
-class BPF : public RBJFilter_base
-{
-public:
+        Peak();
 
-    BPF();
+        void calculateCoeffs (float fc, float fs, int order) override;
+        void process (SampleType& input) override;
+        using FilterBase<SampleType>::process;
 
-    void calculateCoeffs (float fc, float fs, int order) override;
-    void  process (float& input) override;
+    private:
+        SampleType calculateBandwidth (int order) override;
+    };
 
-private:
-    float calculateBandwidth (int order) override;
-};
 
+    template <typename SampleType>
+    class BPF : public FilterBase<SampleType>
+    {
+    public:
+        using FilterBase<SampleType>::coeffs;
+        using FilterBase<SampleType>::state;
+        using FilterBase<SampleType>::norm;
+        using FilterBase<SampleType>::freqc;
+        using FilterBase<SampleType>::q;
 
+        BPF();
 
-class BPFcQ : public RBJFilter_base
-{
-public:
+        void calculateCoeffs (float fc, float fs, int order) override;
+        void process (SampleType& input) override;
+        using FilterBase<SampleType>::process;
 
-    BPFcQ();
+    private:
+        SampleType calculateBandwidth (int order) override;
+    };
 
-    void calculateCoeffs (float fc, float fs, int order) override;
-    void  process (float& input) override;
 
-private:
-    float calculateBandwidth (int order) override;
-};
+    template <typename SampleType>
+    class BPFcQ : public FilterBase<SampleType>
+    {
+    public:
+        using FilterBase<SampleType>::coeffs;
+        using FilterBase<SampleType>::state;
+        using FilterBase<SampleType>::norm;
+        using FilterBase<SampleType>::freqc;
+        using FilterBase<SampleType>::q;
 
+        BPFcQ();
 
+        void calculateCoeffs (float fc, float fs, int order) override;
+        void process (SampleType& input) override;
+        using FilterBase<SampleType>::process;
 
-class Notch : public RBJFilter_base
-{
-public:
+    private:
+        SampleType calculateBandwidth (int order) override;
+    };
 
-    Notch();
 
-    void calculateCoeffs (float fc, float fs, int order) override;
-    void  process (float& input) override;
+    template <typename SampleType>
+    class Notch : public FilterBase<SampleType>
+    {
+    public:
+        using FilterBase<SampleType>::coeffs;
+        using FilterBase<SampleType>::state;
+        using FilterBase<SampleType>::norm;
+        using FilterBase<SampleType>::freqc;
+        using FilterBase<SampleType>::q;
 
-private:
-    float calculateBandwidth (int order) override;
-};
+        Notch();
 
+        void calculateCoeffs (float fc, float fs, int order) override;
+        void process (SampleType& input) override;
+        using FilterBase<SampleType>::process;
 
+    private:
+        SampleType calculateBandwidth (int order) override;
+    };
 
-class APF : public RBJFilter_base
-{
-public:
 
-    APF();
+    template <typename SampleType>
+    class APF : public FilterBase<SampleType>
+    {
+    public:
+        using FilterBase<SampleType>::coeffs;
+        using FilterBase<SampleType>::state;
+        using FilterBase<SampleType>::norm;
+        using FilterBase<SampleType>::freqc;
+        using FilterBase<SampleType>::q;
 
-    void calculateCoeffs (float fc, float fs, int order) override;
-    void  process (float& input) override;
+        APF();
 
-private:
-    float calculateBandwidth (int order) override;
-};
+        void calculateCoeffs (float fc, float fs, int order) override;
+        void process (SampleType& input) override;
+        using FilterBase<SampleType>::process;
 
+    private:
+        SampleType calculateBandwidth (int order) override;
+    };
 
 
-class LowShelf : public RBJFilter_base
-{
-public:
+    template <typename SampleType>
+    class LowShelf : public FilterBase<SampleType>
+    {
+    public:
+        using FilterBase<SampleType>::coeffs;
+        using FilterBase<SampleType>::state;
+        using FilterBase<SampleType>::norm;
+        using FilterBase<SampleType>::freqc;
+        using FilterBase<SampleType>::q;
 
-    LowShelf();
+        LowShelf();
 
-    void calculateCoeffs (float fc, float fs, int order) override;
-    void  process (float& input) override;
+        void calculateCoeffs (float fc, float fs, int order) override;
+        void process (SampleType& input) override;
+        using FilterBase<SampleType>::process;
 
-private:
-    float calculateBandwidth (int order) override;
-};
+    private:
+        SampleType calculateBandwidth (int order) override;
+    };
 
 
+    template <typename SampleType>
+    class HighShelf : public FilterBase<SampleType>
+    {
+    public:
+        using FilterBase<SampleType>::coeffs;
+        using FilterBase<SampleType>::state;
+        using FilterBase<SampleType>::norm;
+        using FilterBase<SampleType>::freqc;
+        using FilterBase<SampleType>::q;
 
-class HighShelf : public RBJFilter_base
-{
-public:
+        HighShelf();
 
-    HighShelf();
+        void calculateCoeffs (float fc, float fs, int order) override;
+        void process (SampleType& input) override;
+        using FilterBase<SampleType>::process;
 
-    void calculateCoeffs (float fc, float fs, int order) override;
-    void  process (float& input) override;
+    private:
+        SampleType calculateBandwidth (int order) override;
+    };
 
-private:
-    float calculateBandwidth (int order) override;
-};
\ No newline at end of file
+    extern template class FilterBase<float>;
+    extern template class FilterBase<double>;
+    extern template class LPF<float>;
+    extern template class LPF<double>;
+    extern template class HPF<float>;
+    extern template class HPF<double>;
+    extern template class Peak<float>;
+    extern template class Peak<double>;
+    extern template class BPF<float>;
+    extern template class BPF<double>;
+    extern template class BPFcQ<float>;
+    extern template class BPFcQ<double>;
+    extern template class Notch<float>;
+    extern template class Notch<double>;
+    extern template class APF<float>;
+    extern template class APF<double>;
+    extern template class LowShelf<float>;
+    extern template class LowShelf<double>;
+    extern template class HighShelf<float>;
+    extern template class HighShelf<double>;
+}
+
+using RBJFilter_base = RBJ::FilterBase<float>;
+using LPF = RBJ::LPF<float>;
+using HPF = RBJ::HPF<float>;
+using Peak = RBJ::Peak<float>;
+using BPF = RBJ::BPF<float>;
+using BPFcQ = RBJ::BPFcQ<float>;
+using Notch = RBJ::Notch<float>;
+using APF = RBJ::APF<float>;
+using LowShelf = RBJ::LowShelf<float>;
+using HighShelf = RBJ::HighShelf<float>;
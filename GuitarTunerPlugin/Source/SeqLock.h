@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+// Single writer snapshot of a trivially copyable T that any number of threads can read.
+// The writer never waits, readers retry while a write is in progress so a snapshot is never torn and nobody locks.
+// The payload is kept in relaxed atomic words rather than a plain T so the racing copy is well defined.
+
+template <typename T>
+class SeqLock
+{
+public:
+    static_assert (std::is_trivially_copyable_v<T>, "SeqLock copies T word by word");
+
+    SeqLock() noexcept { store (T {}); }
+
+    // writer thread only
+    void store (const T& value) noexcept
+    {
+        Words words {};
+        memcpy (words.data(), &value, sizeof (T));
+
+        const auto seq = sequence.load (std::memory_order_relaxed);
+        sequence.store (seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+
+        for (size_t i = 0; i < numWords; ++i)
+            payload[i].store (words[i], std::memory_order_relaxed);
+
+        sequence.store (seq + 2, std::memory_order_release);
+    }
+
+    T load() const noexcept
+    {
+        Words words;
+
+        for (;;)
+        {
+            const auto before = sequence.load (std::memory_order_acquire);
+
+            if ((before & 1) != 0)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            for (size_t i = 0; i < numWords; ++i)
+                words[i] = payload[i].load (std::memory_order_relaxed);
+
+            std::atomic_thread_fence (std::memory_order_acquire);
+
+            if (sequence.load (std::memory_order_relaxed) == before)
+                break;
+        }
+
+        T value;
+        memcpy (static_cast<void*> (&value), words.data(), sizeof (T));
+        return value;
+    }
+
+private:
+    static constexpr size_t numWords = (sizeof (T) + sizeof (uint32_t) - 1) / sizeof (uint32_t);
+    using Words = std::array<uint32_t, numWords>;
+
+    std::atomic<uint32_t> sequence { 0 };
+    std::array<std::atomic<uint32_t>, numWords> payload;
+};
@@ -1,31 +1,201 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 
 namespace Utils
 {
-    static int frequencyToMidi (float frequency) noexcept
+    // Note tables for MIDI 0 - 127 at A4 = 440 Hz, built at compile time. Other references scale every frequency
+    // by reference / 440 so the lookups divide the input by that instead of rebuilding anything.
+    namespace NoteTable
     {
-        constexpr float a4_receip = 1.0f / 440.0f;
-        const float note = 69.0f + 12.0f * std::log2 (frequency * a4_receip);
-        return static_cast<int> (note + 0.5f);
+        static constexpr int numNotes = 128;
+        static constexpr float referenceA4 = 440.0f;
+
+        // 2^x for |x| <= 1 by its Taylor series, std::pow is not constexpr
+        constexpr double exp2 (double x)
+        {
+            const double y = x * 0.693147180559945309417;
+            double term = 1.0;
+            double sum = 1.0;
+
+            for (int n = 1; n < 30; ++n)
+            {
+                term *= y / n;
+                sum += term;
+            }
+
+            return sum;
+        }
+
+        constexpr double semitonesToRatio (double semitones)
+        {
+            double ratio = 1.0;
+
+            for (; semitones >= 12.0; semitones -= 12.0)
+                ratio *= 2.0;
+
+            for (; semitones < 0.0; semitones += 12.0)
+                ratio *= 0.5;
+
+            return ratio * exp2 (semitones / 12.0);
+        }
+
+        static constexpr auto frequencies = []
+        {
+            std::array<float, numNotes> table {};
+
+            for (int midi = 0; midi < numNotes; ++midi)
+                table[static_cast<size_t> (midi)] = static_cast<float> (referenceA4 * semitonesToRatio (midi - 69));
+
+            return table;
+        }();
+
+        // lower edge of every note, 50 cents below it, so note n covers [lowerBounds[n], lowerBounds[n + 1])
+        static constexpr auto lowerBounds = []
+        {
+            std::array<float, numNotes> table {};
+
+            for (int midi = 0; midi < numNotes; ++midi)
+                table[static_cast<size_t> (midi)] = static_cast<float> (referenceA4 * semitonesToRatio (midi - 69.5));
+
+            return table;
+        }();
+
+        // upper edge of the last note, frequencies from here on are outside the table
+        static constexpr auto upperBound = static_cast<float> (referenceA4 * semitonesToRatio (numNotes - 1 - 69 + 0.5));
+
+        // same octave numbering as midiNoteToName
+        struct Name
+        {
+            char text[5];
+        };
+
+        static constexpr auto names = []
+        {
+            constexpr const char* letters[12] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+            std::array<Name, numNotes> table {};
+
+            for (int midi = 0; midi < numNotes; ++midi)
+            {
+                auto& name = table[static_cast<size_t> (midi)].text;
+                const char* letter = letters[midi % 12];
+                const int octave = midi / 12;
+                int length = 0;
+
+                while (*letter != '\0')
+                    name[length++] = *letter++;
+
+                if (octave >= 10)
+                    name[length++] = static_cast<char> ('0' + octave / 10);
+
+                name[length++] = static_cast<char> ('0' + octave % 10);
+                name[length] = '\0';
+            }
+
+            return table;
+        }();
     }
 
-    static float midiToFrequency (int midi) noexcept
+    // log2 from the float exponent plus an atanh series on the mantissa folded into [sqrt(1/2), sqrt(2)).
+    // The series is within 2e-7 of the mantissa's log2, the result within 1e-6 of an exact log2 for 8 Hz - 24 kHz
+    // and within 4e-6 for any positive normal x, where rounding the result to float dominates as for std::log2f.
+    inline float fastLog2 (float x) noexcept
     {
-        constexpr float receip = 1.0f / 12.0f;
-        const float frequency = 440.0f * (std::powf (2.0f, (static_cast<float> (midi - 69) * receip)));
-        return frequency;
+        uint32_t bits;
+        memcpy (&bits, &x, sizeof (bits));
+
+        int exponent = static_cast<int> ((bits >> 23) & 0xff) - 127;
+        bits = (bits & 0x007fffffu) | 0x3f800000u;
+
+        float mantissa;
+        memcpy (&mantissa, &bits, sizeof (mantissa));
+
+        if (mantissa > 1.41421356f)
+        {
+            mantissa *= 0.5f;
+            ++exponent;
+        }
+
+        // ln (m) = 2 atanh (y), y = (m - 1) / (m + 1), |y| < 0.172
+        const float y = (mantissa - 1.0f) / (mantissa + 1.0f);
+        const float y2 = y * y;
+        const float series = y * (2.0f + y2 * (2.0f / 3.0f + y2 * (2.0f / 5.0f + y2 * (2.0f / 7.0f))));
+
+        return static_cast<float> (exponent) + series * 1.44269504f;
+    }
+
+    struct NoteAndCents
+    {
+        int midi = -1;
+        float cents = 0.0f;
+        const char* name = "";
+    };
+
+    // Allocation free version of midiNoteToName, empty for notes outside MIDI 12 - 127
+    inline const char* midiNoteName (int midi) noexcept
+    {
+        if (midi < 12 || midi >= NoteTable::numNotes)
+            return "";
+
+        return NoteTable::names[static_cast<size_t> (midi)].text;
     }
 
-    static juce::String midiNoteToName (int midi) noexcept
+    // Nearest note and the deviation from it in cents, referenceA4 is the stored tuning_offset in Hz and its default
+    // of 0, like any value that is not positive, means 440 Hz. Allocation free, a binary search over the note edges
+    // and one fastLog2. midi is -1 outside the table, below the lower edge of MIDI 0 or from the upper edge of 127 on,
+    // and name is midiNoteName (midi).
+    inline NoteAndCents frequencyToNoteAndCents (float frequency, float referenceA4 = NoteTable::referenceA4) noexcept
     {
-        const int octave = (midi - 12) / 12;
-        const int noteIndex = (midi - 12) % 12;
+        if (! (frequency > 0.0f))
+            return {};
+
+        if (! (referenceA4 > 0.0f))
+            referenceA4 = NoteTable::referenceA4;
+
+        const float normalised = frequency * (NoteTable::referenceA4 / referenceA4);
+
+        if (! (normalised < NoteTable::upperBound))
+            return {};
+
+        const auto* edge = std::upper_bound (NoteTable::lowerBounds.begin(), NoteTable::lowerBounds.end(), normalised);
+
+        if (edge == NoteTable::lowerBounds.begin())
+            return {};
+
+        const auto midi = static_cast<int> (edge - NoteTable::lowerBounds.begin()) - 1;
+        const auto index = static_cast<size_t> (midi);
 
-        if (noteIndex > 12 || noteIndex < 0)
+        NoteAndCents result;
+        result.midi = midi;
+        result.cents = 1200.0f * fastLog2 (normalised / NoteTable::frequencies[index]);
+        result.name = midiNoteName (midi);
+
+        return result;
+    }
+
+    inline int frequencyToMidi (float frequency) noexcept
+    {
+        const float note = 69.0f + 12.0f * fastLog2 (frequency * (1.0f / NoteTable::referenceA4));
+        return static_cast<int> (note + 0.5f);
+    }
+
+    // 0 outside MIDI notes 0 - 127, like the -1 of frequencyToNoteAndCents no pitch comes back for a bad note
+    inline float midiToFrequency (int midi) noexcept
+    {
+        if (midi < 0 || midi >= NoteTable::numNotes)
+            return 0.0f;
+
+        return NoteTable::frequencies[static_cast<size_t> (midi)];
+    }
+
+    inline juce::String midiNoteToName (int midi) noexcept
+    {
+        if (midi < 12 || midi >= NoteTable::numNotes)
             return "error";
 
-        std::array<std::string, 12> noteNames = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
-        return juce::String (noteNames.at (static_cast<size_t> (noteIndex))) + juce::String (octave + 1);
+        return midiNoteName (midi);
     }
-}
\ No newline at end of file
+}
@@ -1,29 +1,631 @@
 #pragma once
 #define VIMAGE_H
 
-#if !IS_WINDOWS
-#include <Accelerate/Accelerate.h>
+#include <algorithm>
+#include <numeric>
+
+// Backends - Accelerate on macOS, IPP on Windows when found, SSE/AVX2 or NEON intrinsics elsewhere.
+// The x86 path is built for the SSE2 baseline and switches to AVX2/FMA at runtime when the CPU has it.
+
+#if defined (__APPLE__)
+ #define VECTOROPS_ACCELERATE 1
+ #include <Accelerate/Accelerate.h>
 #elif IS_WINDOWS && WITH_IPP
-#include <ipp.h>
+ #define VECTOROPS_IPP 1
+ #include <ipp.h>
+ #include <immintrin.h>
+#elif defined (__x86_64__) && (defined (__GNUC__) || defined (__clang__))
+ #define VECTOROPS_X86 1
+ #include <immintrin.h>
+#elif defined (__aarch64__)
+ #define VECTOROPS_NEON 1
+ #include <arm_neon.h>
 #endif
 
 namespace VectorOps
 {
-#if !IS_WINDOWS
-    static inline void sum (float* input, float* output, int size)
+    // squaredDistance (a, b)        = sum (a[i] - b[i])^2, fused so nothing is written but the result
+    // squaredDistanceLags (a, b)[k] = squaredDistance (a, b + k) for k < squaredDistanceLagCount,
+    //                                 b must hold size + squaredDistanceLagCount - 1 samples
+    static constexpr int squaredDistanceLagCount = 4;
+
+    // squaredDistanceLagsInterleaved works on interleaved channels stored [sample][lane] with interleavedLaneCount lanes,
+    // output[k * interleavedLaneCount + lane] = squaredDistanceLags for that lane, b offsets are in samples
+    static constexpr int interleavedLaneCount = 8;
+
+#if VECTOROPS_X86 || VECTOROPS_IPP
+    // SSE2 kernels, the x86 baseline. IPP builds use them where IPP has no fused equivalent.
+    namespace detail
+    {
+        inline float horizontalSum (__m128 v) noexcept
+        {
+            const __m128 shuffled = _mm_movehl_ps (v, v);
+            const __m128 pairs = _mm_add_ps (v, shuffled);
+            return _mm_cvtss_f32 (_mm_add_ss (pairs, _mm_shuffle_ps (pairs, pairs, 0x55)));
+        }
+
+        inline float sumSse (const float* input, int size) noexcept
+        {
+            __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+            int i = 0;
+
+            for (; i + 16 <= size; i += 16)
+            {
+                acc0 = _mm_add_ps (acc0, _mm_loadu_ps (input + i));
+                acc1 = _mm_add_ps (acc1, _mm_loadu_ps (input + i + 4));
+                acc2 = _mm_add_ps (acc2, _mm_loadu_ps (input + i + 8));
+                acc3 = _mm_add_ps (acc3, _mm_loadu_ps (input + i + 12));
+            }
+
+            float result = horizontalSum (_mm_add_ps (_mm_add_ps (acc0, acc1), _mm_add_ps (acc2, acc3)));
+
+            for (; i < size; ++i)
+                result += input[i];
+
+            return result;
+        }
+
+        inline float dotProductSse (const float* a, const float* b, int size) noexcept
+        {
+            __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+            int i = 0;
+
+            for (; i + 16 <= size; i += 16)
+            {
+                acc0 = _mm_add_ps (acc0, _mm_mul_ps (_mm_loadu_ps (a + i),      _mm_loadu_ps (b + i)));
+                acc1 = _mm_add_ps (acc1, _mm_mul_ps (_mm_loadu_ps (a + i + 4),  _mm_loadu_ps (b + i + 4)));
+                acc2 = _mm_add_ps (acc2, _mm_mul_ps (_mm_loadu_ps (a + i + 8),  _mm_loadu_ps (b + i + 8)));
+                acc3 = _mm_add_ps (acc3, _mm_mul_ps (_mm_loadu_ps (a + i + 12), _mm_loadu_ps (b + i + 12)));
+            }
+
+            float result = horizontalSum (_mm_add_ps (_mm_add_ps (acc0, acc1), _mm_add_ps (acc2, acc3)));
+
+            for (; i < size; ++i)
+                result += a[i] * b[i];
+
+            return result;
+        }
+
+        inline float squaredDistanceSse (const float* a, const float* b, int size) noexcept
+        {
+            __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+            int i = 0;
+
+            for (; i + 16 <= size; i += 16)
+            {
+                const __m128 d0 = _mm_sub_ps (_mm_loadu_ps (a + i),      _mm_loadu_ps (b + i));
+                const __m128 d1 = _mm_sub_ps (_mm_loadu_ps (a + i + 4),  _mm_loadu_ps (b + i + 4));
+                const __m128 d2 = _mm_sub_ps (_mm_loadu_ps (a + i + 8),  _mm_loadu_ps (b + i + 8));
+                const __m128 d3 = _mm_sub_ps (_mm_loadu_ps (a + i + 12), _mm_loadu_ps (b + i + 12));
+
+                acc0 = _mm_add_ps (acc0, _mm_mul_ps (d0, d0));
+                acc1 = _mm_add_ps (acc1, _mm_mul_ps (d1, d1));
+                acc2 = _mm_add_ps (acc2, _mm_mul_ps (d2, d2));
+                acc3 = _mm_add_ps (acc3, _mm_mul_ps (d3, d3));
+            }
+
+            float result = horizontalSum (_mm_add_ps (_mm_add_ps (acc0, acc1), _mm_add_ps (acc2, acc3)));
+
+            for (; i < size; ++i)
+                result += (a[i] - b[i]) * (a[i] - b[i]);
+
+            return result;
+        }
+
+        // a is loaded once per step and compared against b at four adjacent offsets
+        inline void squaredDistanceLagsSse (const float* a, const float* b, float* output, int size) noexcept
+        {
+            __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+            int i = 0;
+
+            for (; i + 4 <= size; i += 4)
+            {
+                const __m128 va = _mm_loadu_ps (a + i);
+                const __m128 d0 = _mm_sub_ps (va, _mm_loadu_ps (b + i));
+                const __m128 d1 = _mm_sub_ps (va, _mm_loadu_ps (b + i + 1));
+                const __m128 d2 = _mm_sub_ps (va, _mm_loadu_ps (b + i + 2));
+                const __m128 d3 = _mm_sub_ps (va, _mm_loadu_ps (b + i + 3));
+
+                acc0 = _mm_add_ps (acc0, _mm_mul_ps (d0, d0));
+                acc1 = _mm_add_ps (acc1, _mm_mul_ps (d1, d1));
+                acc2 = _mm_add_ps (acc2, _mm_mul_ps (d2, d2));
+                acc3 = _mm_add_ps (acc3, _mm_mul_ps (d3, d3));
+            }
+
+            output[0] = horizontalSum (acc0);
+            output[1] = horizontalSum (acc1);
+            output[2] = horizontalSum (acc2);
+            output[3] = horizontalSum (acc3);
+
+            for (; i < size; ++i)
+                for (int k = 0; k < 4; ++k)
+                    output[k] += (a[i] - b[i + k]) * (a[i] - b[i + k]);
+        }
+
+        // One sample of every lane per register row, the four lags are whole rows apart so no unaligned shuffles
+        inline void squaredDistanceLagsInterleavedSse (const float* a, const float* b, float* output, int size) noexcept
+        {
+            __m128 lo[4], hi[4];
+
+            for (int k = 0; k < 4; ++k)
+                lo[k] = hi[k] = _mm_setzero_ps();
+
+            for (int i = 0; i < size; ++i)
+            {
+                const __m128 alo = _mm_loadu_ps (a + i * 8);
+                const __m128 ahi = _mm_loadu_ps (a + i * 8 + 4);
+
+                for (int k = 0; k < 4; ++k)
+                {
+                    const __m128 dlo = _mm_sub_ps (alo, _mm_loadu_ps (b + (i + k) * 8));
+                    const __m128 dhi = _mm_sub_ps (ahi, _mm_loadu_ps (b + (i + k) * 8 + 4));
+
+                    lo[k] = _mm_add_ps (lo[k], _mm_mul_ps (dlo, dlo));
+                    hi[k] = _mm_add_ps (hi[k], _mm_mul_ps (dhi, dhi));
+                }
+            }
+
+            for (int k = 0; k < 4; ++k)
+            {
+                _mm_storeu_ps (output + k * 8, lo[k]);
+                _mm_storeu_ps (output + k * 8 + 4, hi[k]);
+            }
+        }
+    }
+#endif
+
+#if VECTOROPS_X86
+    namespace detail
+    {
+        inline bool hasAvx2() noexcept
+        {
+            static const bool supported = []
+            {
+                __builtin_cpu_init();
+                return __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma");
+            }();
+
+            return supported;
+        }
+
+        __attribute__ ((target ("avx2,fma"))) inline float horizontalSum (__m256 v) noexcept
+        {
+            return horizontalSum (_mm_add_ps (_mm256_castps256_ps128 (v), _mm256_extractf128_ps (v, 1)));
+        }
+
+        __attribute__ ((target ("avx2,fma"))) inline float sumAvx2 (const float* input, int size) noexcept
+        {
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps(), acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+            int i = 0;
+
+            for (; i + 32 <= size; i += 32)
+            {
+                acc0 = _mm256_add_ps (acc0, _mm256_loadu_ps (input + i));
+                acc1 = _mm256_add_ps (acc1, _mm256_loadu_ps (input + i + 8));
+                acc2 = _mm256_add_ps (acc2, _mm256_loadu_ps (input + i + 16));
+                acc3 = _mm256_add_ps (acc3, _mm256_loadu_ps (input + i + 24));
+            }
+
+            float result = horizontalSum (_mm256_add_ps (_mm256_add_ps (acc0, acc1), _mm256_add_ps (acc2, acc3)));
+
+            for (; i < size; ++i)
+                result += input[i];
+
+            return result;
+        }
+
+        __attribute__ ((target ("avx2,fma"))) inline float dotProductAvx2 (const float* a, const float* b, int size) noexcept
+        {
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps(), acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+            int i = 0;
+
+            for (; i + 32 <= size; i += 32)
+            {
+                acc0 = _mm256_fmadd_ps (_mm256_loadu_ps (a + i),      _mm256_loadu_ps (b + i),      acc0);
+                acc1 = _mm256_fmadd_ps (_mm256_loadu_ps (a + i + 8),  _mm256_loadu_ps (b + i + 8),  acc1);
+                acc2 = _mm256_fmadd_ps (_mm256_loadu_ps (a + i + 16), _mm256_loadu_ps (b + i + 16), acc2);
+                acc3 = _mm256_fmadd_ps (_mm256_loadu_ps (a + i + 24), _mm256_loadu_ps (b + i + 24), acc3);
+            }
+
+            float result = horizontalSum (_mm256_add_ps (_mm256_add_ps (acc0, acc1), _mm256_add_ps (acc2, acc3)));
+
+            for (; i < size; ++i)
+                result += a[i] * b[i];
+
+            return result;
+        }
+
+        __attribute__ ((target ("avx2,fma"))) inline float squaredDistanceAvx2 (const float* a, const float* b, int size) noexcept
+        {
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps(), acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+            int i = 0;
+
+            for (; i + 32 <= size; i += 32)
+            {
+                const __m256 d0 = _mm256_sub_ps (_mm256_loadu_ps (a + i),      _mm256_loadu_ps (b + i));
+                const __m256 d1 = _mm256_sub_ps (_mm256_loadu_ps (a + i + 8),  _mm256_loadu_ps (b + i + 8));
+                const __m256 d2 = _mm256_sub_ps (_mm256_loadu_ps (a + i + 16), _mm256_loadu_ps (b + i + 16));
+                const __m256 d3 = _mm256_sub_ps (_mm256_loadu_ps (a + i + 24), _mm256_loadu_ps (b + i + 24));
+
+                acc0 = _mm256_fmadd_ps (d0, d0, acc0);
+                acc1 = _mm256_fmadd_ps (d1, d1, acc1);
+                acc2 = _mm256_fmadd_ps (d2, d2, acc2);
+                acc3 = _mm256_fmadd_ps (d3, d3, acc3);
+            }
+
+            float result = horizontalSum (_mm256_add_ps (_mm256_add_ps (acc0, acc1), _mm256_add_ps (acc2, acc3)));
+
+            for (; i < size; ++i)
+                result += (a[i] - b[i]) * (a[i] - b[i]);
+
+            return result;
+        }
+
+        __attribute__ ((target ("avx2,fma"))) inline void squaredDistanceLagsAvx2 (const float* a, const float* b, float* output, int size) noexcept
+        {
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps(), acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+            int i = 0;
+
+            for (; i + 8 <= size; i += 8)
+            {
+                const __m256 va = _mm256_loadu_ps (a + i);
+                const __m256 d0 = _mm256_sub_ps (va, _mm256_loadu_ps (b + i));
+                const __m256 d1 = _mm256_sub_ps (va, _mm256_loadu_ps (b + i + 1));
+                const __m256 d2 = _mm256_sub_ps (va, _mm256_loadu_ps (b + i + 2));
+                const __m256 d3 = _mm256_sub_ps (va, _mm256_loadu_ps (b + i + 3));
+
+                acc0 = _mm256_fmadd_ps (d0, d0, acc0);
+                acc1 = _mm256_fmadd_ps (d1, d1, acc1);
+                acc2 = _mm256_fmadd_ps (d2, d2, acc2);
+                acc3 = _mm256_fmadd_ps (d3, d3, acc3);
+            }
+
+            output[0] = horizontalSum (acc0);
+            output[1] = horizontalSum (acc1);
+            output[2] = horizontalSum (acc2);
+            output[3] = horizontalSum (acc3);
+
+            for (; i < size; ++i)
+                for (int k = 0; k < 4; ++k)
+                    output[k] += (a[i] - b[i + k]) * (a[i] - b[i + k]);
+        }
+
+        __attribute__ ((target ("avx2,fma"))) inline void squaredDistanceLagsInterleavedAvx2 (const float* a, const float* b, float* output, int size) noexcept
+        {
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps(), acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+
+            for (int i = 0; i < size; ++i)
+            {
+                const __m256 va = _mm256_loadu_ps (a + i * 8);
+                const __m256 d0 = _mm256_sub_ps (va, _mm256_loadu_ps (b + i * 8));
+                const __m256 d1 = _mm256_sub_ps (va, _mm256_loadu_ps (b + i * 8 + 8));
+                const __m256 d2 = _mm256_sub_ps (va, _mm256_loadu_ps (b + i * 8 + 16));
+                const __m256 d3 = _mm256_sub_ps (va, _mm256_loadu_ps (b + i * 8 + 24));
+
+                acc0 = _mm256_fmadd_ps (d0, d0, acc0);
+                acc1 = _mm256_fmadd_ps (d1, d1, acc1);
+                acc2 = _mm256_fmadd_ps (d2, d2, acc2);
+                acc3 = _mm256_fmadd_ps (d3, d3, acc3);
+            }
+
+            _mm256_storeu_ps (output,      acc0);
+            _mm256_storeu_ps (output + 8,  acc1);
+            _mm256_storeu_ps (output + 16, acc2);
+            _mm256_storeu_ps (output + 24, acc3);
+        }
+    }
+#elif VECTOROPS_NEON
+    namespace detail
+    {
+        inline float sumNeon (const float* input, int size) noexcept
+        {
+            float32x4_t acc0 = vdupq_n_f32 (0.0f), acc1 = vdupq_n_f32 (0.0f), acc2 = vdupq_n_f32 (0.0f), acc3 = vdupq_n_f32 (0.0f);
+            int i = 0;
+
+            for (; i + 16 <= size; i += 16)
+            {
+                acc0 = vaddq_f32 (acc0, vld1q_f32 (input + i));
+                acc1 = vaddq_f32 (acc1, vld1q_f32 (input + i + 4));
+                acc2 = vaddq_f32 (acc2, vld1q_f32 (input + i + 8));
+                acc3 = vaddq_f32 (acc3, vld1q_f32 (input + i + 12));
+            }
+
+            float result = vaddvq_f32 (vaddq_f32 (vaddq_f32 (acc0, acc1), vaddq_f32 (acc2, acc3)));
+
+            for (; i < size; ++i)
+                result += input[i];
+
+            return result;
+        }
+
+        inline float dotProductNeon (const float* a, const float* b, int size) noexcept
+        {
+            float32x4_t acc0 = vdupq_n_f32 (0.0f), acc1 = vdupq_n_f32 (0.0f), acc2 = vdupq_n_f32 (0.0f), acc3 = vdupq_n_f32 (0.0f);
+            int i = 0;
+
+            for (; i + 16 <= size; i += 16)
+            {
+                acc0 = vfmaq_f32 (acc0, vld1q_f32 (a + i),      vld1q_f32 (b + i));
+                acc1 = vfmaq_f32 (acc1, vld1q_f32 (a + i + 4),  vld1q_f32 (b + i + 4));
+                acc2 = vfmaq_f32 (acc2, vld1q_f32 (a + i + 8),  vld1q_f32 (b + i + 8));
+                acc3 = vfmaq_f32 (acc3, vld1q_f32 (a + i + 12), vld1q_f32 (b + i + 12));
+            }
+
+            float result = vaddvq_f32 (vaddq_f32 (vaddq_f32 (acc0, acc1), vaddq_f32 (acc2, acc3)));
+
+            for (; i < size; ++i)
+                result += a[i] * b[i];
+
+            return result;
+        }
+
+        inline float squaredDistanceNeon (const float* a, const float* b, int size) noexcept
+        {
+            float32x4_t acc0 = vdupq_n_f32 (0.0f), acc1 = vdupq_n_f32 (0.0f), acc2 = vdupq_n_f32 (0.0f), acc3 = vdupq_n_f32 (0.0f);
+            int i = 0;
+
+            for (; i + 16 <= size; i += 16)
+            {
+                const float32x4_t d0 = vsubq_f32 (vld1q_f32 (a + i),      vld1q_f32 (b + i));
+                const float32x4_t d1 = vsubq_f32 (vld1q_f32 (a + i + 4),  vld1q_f32 (b + i + 4));
+                const float32x4_t d2 = vsubq_f32 (vld1q_f32 (a + i + 8),  vld1q_f32 (b + i + 8));
+                const float32x4_t d3 = vsubq_f32 (vld1q_f32 (a + i + 12), vld1q_f32 (b + i + 12));
+
+                acc0 = vfmaq_f32 (acc0, d0, d0);
+                acc1 = vfmaq_f32 (acc1, d1, d1);
+                acc2 = vfmaq_f32 (acc2, d2, d2);
+                acc3 = vfmaq_f32 (acc3, d3, d3);
+            }
+
+            float result = vaddvq_f32 (vaddq_f32 (vaddq_f32 (acc0, acc1), vaddq_f32 (acc2, acc3)));
+
+            for (; i < size; ++i)
+                result += (a[i] - b[i]) * (a[i] - b[i]);
+
+            return result;
+        }
+
+        inline void squaredDistanceLagsNeon (const float* a, const float* b, float* output, int size) noexcept
+        {
+            float32x4_t acc0 = vdupq_n_f32 (0.0f), acc1 = vdupq_n_f32 (0.0f), acc2 = vdupq_n_f32 (0.0f), acc3 = vdupq_n_f32 (0.0f);
+            int i = 0;
+
+            for (; i + 4 <= size; i += 4)
+            {
+                const float32x4_t va = vld1q_f32 (a + i);
+                const float32x4_t d0 = vsubq_f32 (va, vld1q_f32 (b + i));
+                const float32x4_t d1 = vsubq_f32 (va, vld1q_f32 (b + i + 1));
+                const float32x4_t d2 = vsubq_f32 (va, vld1q_f32 (b + i + 2));
+                const float32x4_t d3 = vsubq_f32 (va, vld1q_f32 (b + i + 3));
+
+                acc0 = vfmaq_f32 (acc0, d0, d0);
+                acc1 = vfmaq_f32 (acc1, d1, d1);
+                acc2 = vfmaq_f32 (acc2, d2, d2);
+                acc3 = vfmaq_f32 (acc3, d3, d3);
+            }
+
+            output[0] = vaddvq_f32 (acc0);
+            output[1] = vaddvq_f32 (acc1);
+            output[2] = vaddvq_f32 (acc2);
+            output[3] = vaddvq_f32 (acc3);
+
+            for (; i < size; ++i)
+                for (int k = 0; k < 4; ++k)
+                    output[k] += (a[i] - b[i + k]) * (a[i] - b[i + k]);
+        }
+
+        inline void squaredDistanceLagsInterleavedNeon (const float* a, const float* b, float* output, int size) noexcept
+        {
+            float32x4_t lo[4], hi[4];
+
+            for (int k = 0; k < 4; ++k)
+                lo[k] = hi[k] = vdupq_n_f32 (0.0f);
+
+            for (int i = 0; i < size; ++i)
+            {
+                const float32x4_t alo = vld1q_f32 (a + i * 8);
+                const float32x4_t ahi = vld1q_f32 (a + i * 8 + 4);
+
+                for (int k = 0; k < 4; ++k)
+                {
+                    const float32x4_t dlo = vsubq_f32 (alo, vld1q_f32 (b + (i + k) * 8));
+                    const float32x4_t dhi = vsubq_f32 (ahi, vld1q_f32 (b + (i + k) * 8 + 4));
+
+                    lo[k] = vfmaq_f32 (lo[k], dlo, dlo);
+                    hi[k] = vfmaq_f32 (hi[k], dhi, dhi);
+                }
+            }
+
+            for (int k = 0; k < 4; ++k)
+            {
+                vst1q_f32 (output + k * 8, lo[k]);
+                vst1q_f32 (output + k * 8 + 4, hi[k]);
+            }
+        }
+    }
+#endif
+
+#if VECTOROPS_ACCELERATE
+    static inline void sum (const float* input, float* output, int size)
     {
         vDSP_sve (input, 1, output, static_cast<size_t> (size));
     }
-#elif IS_WINDOWS && WITH_IPP
-    static inline void sum (float* input, float* output, int size)
+
+    static inline void dotProduct (const float* a, const float* b, float* output, int size)
+    {
+        vDSP_dotpr (a, 1, b, 1, output, static_cast<size_t> (size));
+    }
+
+    static inline void sumOfSquares (const float* input, float* output, int size)
+    {
+        vDSP_svesq (input, 1, output, static_cast<size_t> (size));
+    }
+
+    static inline void squaredDistance (const float* a, const float* b, float* output, int size)
+    {
+        vDSP_distancesq (a, 1, b, 1, output, static_cast<size_t> (size));
+    }
+
+    static inline void squaredDistanceLags (const float* a, const float* b, float* output, int size)
+    {
+        for (int k = 0; k < squaredDistanceLagCount; ++k)
+            vDSP_distancesq (a, 1, b + k, 1, output + k, static_cast<size_t> (size));
+    }
+
+    static inline void squaredDistanceLagsInterleaved (const float* a, const float* b, float* output, int size)
+    {
+        constexpr vDSP_Stride stride = interleavedLaneCount;
+
+        for (int k = 0; k < squaredDistanceLagCount; ++k)
+            for (int lane = 0; lane < interleavedLaneCount; ++lane)
+                vDSP_distancesq (a + lane, stride, b + k * stride + lane, stride, output + k * stride + lane, static_cast<size_t> (size));
+    }
+#elif VECTOROPS_IPP
+    // IPP rejects empty input with a status and leaves output alone, the other backends return 0 for it
+    static inline void sum (const float* input, float* output, int size)
+    {
+        if (ippsSum_32f (static_cast<const Ipp32f*> (input), size, static_cast<Ipp32f*> (output), ippAlgHintFast) != ippStsNoErr)
+            *output = 0.0f;
+    }
+
+    static inline void dotProduct (const float* a, const float* b, float* output, int size)
+    {
+        if (ippsDotProd_32f (static_cast<const Ipp32f*> (a), static_cast<const Ipp32f*> (b), size, static_cast<Ipp32f*> (output)) != ippStsNoErr)
+            *output = 0.0f;
+    }
+
+    static inline void sumOfSquares (const float* input, float* output, int size)
+    {
+        dotProduct (input, input, output, size);
+    }
+
+    // IPP only has the L2 norm of a difference, taking its square root and squaring it again loses precision,
+    // so the squared distances use the fused SSE2 kernels
+    static inline void squaredDistance (const float* a, const float* b, float* output, int size)
+    {
+        *output = detail::squaredDistanceSse (a, b, size);
+    }
+
+    static inline void squaredDistanceLags (const float* a, const float* b, float* output, int size)
+    {
+        detail::squaredDistanceLagsSse (a, b, output, size);
+    }
+
+    static inline void squaredDistanceLagsInterleaved (const float* a, const float* b, float* output, int size)
+    {
+        detail::squaredDistanceLagsInterleavedSse (a, b, output, size);
+    }
+#elif VECTOROPS_X86
+    static inline void sum (const float* input, float* output, int size)
+    {
+        *output = detail::hasAvx2() ? detail::sumAvx2 (input, size) : detail::sumSse (input, size);
+    }
+
+    static inline void dotProduct (const float* a, const float* b, float* output, int size)
+    {
+        *output = detail::hasAvx2() ? detail::dotProductAvx2 (a, b, size) : detail::dotProductSse (a, b, size);
+    }
+
+    static inline void sumOfSquares (const float* input, float* output, int size)
     {
-        auto result = ippsSum_32f (static_cast<Ipp32f*> (input), size, static_cast<Ipp32f*> (output), static_cast<IppHintAlgorithm>(1));
+        dotProduct (input, input, output, size);
+    }
+
+    static inline void squaredDistance (const float* a, const float* b, float* output, int size)
+    {
+        *output = detail::hasAvx2() ? detail::squaredDistanceAvx2 (a, b, size) : detail::squaredDistanceSse (a, b, size);
+    }
+
+    static inline void squaredDistanceLags (const float* a, const float* b, float* output, int size)
+    {
+        if (detail::hasAvx2())
+            detail::squaredDistanceLagsAvx2 (a, b, output, size);
+        else
+            detail::squaredDistanceLagsSse (a, b, output, size);
+    }
+
+    static inline void squaredDistanceLagsInterleaved (const float* a, const float* b, float* output, int size)
+    {
+        if (detail::hasAvx2())
+            detail::squaredDistanceLagsInterleavedAvx2 (a, b, output, size);
+        else
+            detail::squaredDistanceLagsInterleavedSse (a, b, output, size);
+    }
+#elif VECTOROPS_NEON
+    static inline void sum (const float* input, float* output, int size)
+    {
+        *output = detail::sumNeon (input, size);
+    }
+
+    static inline void dotProduct (const float* a, const float* b, float* output, int size)
+    {
+        *output = detail::dotProductNeon (a, b, size);
+    }
+
+    static inline void sumOfSquares (const float* input, float* output, int size)
+    {
+        dotProduct (input, input, output, size);
+    }
+
+    static inline void squaredDistance (const float* a, const float* b, float* output, int size)
+    {
+        *output = detail::squaredDistanceNeon (a, b, size);
+    }
+
+    static inline void squaredDistanceLags (const float* a, const float* b, float* output, int size)
+    {
+        detail::squaredDistanceLagsNeon (a, b, output, size);
+    }
+
+    static inline void squaredDistanceLagsInterleaved (const float* a, const float* b, float* output, int size)
+    {
+        detail::squaredDistanceLagsInterleavedNeon (a, b, output, size);
     }
 #else
-    static inline void sum (float* input, float* output, int size)
+    static inline void sum (const float* input, float* output, int size)
     {
         *output = std::accumulate (input, input + size, 0.0f);
     }
+
+    static inline void dotProduct (const float* a, const float* b, float* output, int size)
+    {
+        *output = std::inner_product (a, a + size, b, 0.0f);
+    }
+
+    static inline void sumOfSquares (const float* input, float* output, int size)
+    {
+        dotProduct (input, input, output, size);
+    }
+
+    static inline void squaredDistance (const float* a, const float* b, float* output, int size)
+    {
+        float result = 0.0f;
+
+        for (int i = 0; i < size; ++i)
+            result += (a[i] - b[i]) * (a[i] - b[i]);
+
+        *output = result;
+    }
+
+    static inline void squaredDistanceLags (const float* a, const float* b, float* output, int size)
+    {
+        for (int k = 0; k < squaredDistanceLagCount; ++k)
+            squaredDistance (a, b + k, output + k, size);
+    }
+
+    static inline void squaredDistanceLagsInterleaved (const float* a, const float* b, float* output, int size)
+    {
+        constexpr int lanes = interleavedLaneCount;
+        std::fill (output, output + squaredDistanceLagCount * lanes, 0.0f);
+
+        for (int i = 0; i < size; ++i)
+            for (int k = 0; k < squaredDistanceLagCount; ++k)
+                for (int lane = 0; lane < lanes; ++lane)
+                {
+                    const float d = a[i * lanes + lane] - b[(i + k) * lanes + lane];
+                    output[k * lanes + lane] += d * d;
+                }
+    }
 #endif
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <JuceHeader.h>
+
+// The Yin steps that follow the difference function, shared by GuitarPitchDetectionFX and
+// MultiChannelPitchDetectionFX so both give the same pitch for the same frame. Lag tau of the difference
+// function is difference[tau * stride], stride is the lane count of an interleaved buffer or 1.
+
+namespace YinSearch
+{
+    // Cumulative mean normalised difference for lags [tauBegin, tauEnd). sum carries the running total from the
+    // previous range so a search that extends it a chunk at a time gets exactly the values of one pass.
+    inline void cumulativeMean (const float* difference, size_t stride, float* cumulative, int tauBegin, int tauEnd, float& sum) noexcept
+    {
+        for (auto tau = static_cast<size_t> (tauBegin); tau < static_cast<size_t> (tauEnd); ++tau)
+        {
+            const float d = difference[tau * stride];
+
+            if (tau == 0 || d == 0.0f)
+            {
+                cumulative[tau] = 1.0f;
+                continue;
+            }
+
+            sum += d;
+            cumulative[tau] = d / ((1.0f / static_cast<float> (tau)) * sum);
+        }
+    }
+
+    // First lag from minTau under the threshold, walked down to the bottom of its dip looking lookAhead lags past
+    // the lowest point so far. prepareLags (tauEnd) is called before lags below tauEnd are read, -1 when none is under.
+    template <typename PrepareLags>
+    int absoluteThreshold (const float* cumulative, int minTau, int windowSize, float threshold, int lookAhead, PrepareLags&& prepareLags)
+    {
+        for (int tau = minTau; tau < windowSize; ++tau)
+        {
+            prepareLags (tau + 1);
+
+            if (cumulative[tau] >= threshold)
+                continue;
+
+            int best = tau;
+
+            for (int next = tau + 1; next < windowSize && next <= best + 1 + lookAhead; ++next)
+            {
+                prepareLags (next + 1);
+
+                if (cumulative[next] < cumulative[best])
+                    best = next;
+            }
+
+            return best;
+        }
+
+        return -1;
+    }
+
+    inline int absoluteThreshold (const float* cumulative, int minTau, int windowSize, float threshold) noexcept
+    {
+        return absoluteThreshold (cumulative, minTau, windowSize, threshold, 0, [] (int) {});
+    }
+
+    // Fitted to the raw difference function, the cumulative mean normalisation pulls the vertex at short lags
+    // which costs several cents for high notes once detection runs at a reduced internal rate
+    inline float parabolicInterpolation (const float* difference, size_t stride, int tau, int windowSize) noexcept
+    {
+        if (tau < 1 || tau >= windowSize - 1)
+            return static_cast<float> (tau);
+
+        const auto index = static_cast<size_t> (tau);
+        const float s0 = difference[(index - 1) * stride];
+        const float s1 = difference[index * stride];
+        const float s2 = difference[(index + 1) * stride];
+
+        return static_cast<float> (index) + (s2 - s0) / (2.0f * (2.0f * s1 - s2 - s0));
+    }
+}
@@ -0,0 +1,826 @@
+#include <JuceHeader.h>
+#include "GuitarPitchDetectionFX.h"
+#include "MultiChannelPitchDetectionFX.h"
+#include "SignalGenerators.h"
+#include <thread>
+
+// GuitarTunerAccuracyTests - accuracy of the detector on synthetic notes across the guitar range at 44.1, 48 and
+// 96 kHz, with and without the decimating front end, for every difference engine, tau search and band limit filter.
+// timeDomain/full is the reference: its cent error, octave errors and latency are checked against a stored baseline
+// for each signal and filter, and every other engine and search is compared with it frame by frame. A search that
+// skips lags must make exactly the octave errors of the full search on every note. Strums check every
+// string of the polyphonic mode. The analysis thread, amortised and fixed storage detectors, the level of polyphonic
+// results and the multi-channel detector are each compared with the synchronous detector on the same signal.
+// Prints one line per configuration and returns non-zero when any exceeds its baseline.
+//
+// usage: GuitarTunerAccuracyTests
+
+namespace
+{
+    using Engine = GuitarPitchDetectionFX::DifferenceEngine;
+    using TauSearch = GuitarPitchDetectionFX::TauSearch;
+    using Filter = GuitarPitchDetectionFX::BandLimitFilter;
+    using Waveform = SignalGenerators::Waveform;
+
+    constexpr float onsetSeconds = 0.1f;
+    constexpr float noteSeconds = 0.9f;
+    constexpr float hopSeconds = 0.005f;
+    constexpr float decimatedRate = 8000.0f;
+    constexpr int blockSize = 256;
+
+    // a result within this many cents of the note counts as detected for latency
+    constexpr float lockCents = 10.0f;
+
+    constexpr float sampleRates[] = { 44100.0f, 48000.0f, 96000.0f };
+    constexpr float notes[] = { 82.41f, 110.0f, 146.83f, 196.0f, 246.94f, 329.63f, 659.26f };
+
+    constexpr Engine engines[] = { Engine::timeDomain, Engine::fft, Engine::incremental };
+    constexpr TauSearch searches[] = { TauSearch::full, TauSearch::earlyExit, TauSearch::coarseToFine };
+    constexpr Filter filters[] = { Filter::doublePrecision, Filter::singlePrecision, Filter::filterBank };
+
+    constexpr int numEngines = static_cast<int> (std::size (engines));
+    constexpr int numSearches = static_cast<int> (std::size (searches));
+    constexpr int numConfigs = numEngines * numSearches;
+
+    const char* getName (Engine engine) noexcept
+    {
+        switch (engine)
+        {
+            case Engine::timeDomain:  return "timeDomain";
+            case Engine::fft:         return "fft";
+            case Engine::incremental: return "incremental";
+            default:                  return "";
+        }
+    }
+
+    const char* getName (TauSearch search) noexcept
+    {
+        switch (search)
+        {
+            case TauSearch::full:         return "full";
+            case TauSearch::earlyExit:    return "earlyExit";
+            case TauSearch::coarseToFine: return "coarseToFine";
+            default:                      return "";
+        }
+    }
+
+    const char* getName (Filter filter) noexcept
+    {
+        switch (filter)
+        {
+            case Filter::doublePrecision: return "double";
+            case Filter::singlePrecision: return "float";
+            case Filter::filterBank:      return "bank";
+            default:                      return "";
+        }
+    }
+
+    struct AccuracyStats
+    {
+        double meanCents = 0.0;
+        double maxCents = 0.0;
+        int numFrames = 0;
+        int octaveErrors = 0;
+        double maxLatencyMs = 0.0;
+        int missedNotes = 0;
+    };
+
+    // How far a configuration strays from the reference in the frames both computed, mismatched frames are those where
+    // only one of them found a pitch or they are more than half an octave apart
+    struct FrameStats
+    {
+        double maxCents = 0.0;
+        int mismatchedFrames = 0;
+    };
+
+    // Measured values of timeDomain/full with some headroom, octave errors are exact counts over all the notes of a
+    // row. A change that deliberately moves the numerics updates its rows, anything else that exceeds them is a regression.
+    struct Baseline
+    {
+        Waveform waveform;
+        Filter filter;
+        bool decimated;
+        double meanCents;
+        double maxCents;
+        int octaveErrors;
+        double maxLatencyMs;
+    };
+
+    constexpr Baseline baselines[] =
+    {
+        { Waveform::sine,     Filter::doublePrecision, false, 0.11, 16.3,   0, 50.0 },
+        { Waveform::sine,     Filter::doublePrecision, true,  0.20, 13.0,   0, 45.0 },
+        { Waveform::sine,     Filter::singlePrecision, false, 0.12, 16.3,   0, 50.0 },
+        { Waveform::sine,     Filter::singlePrecision, true,  0.20, 13.0,   0, 45.0 },
+        { Waveform::sine,     Filter::filterBank,      false, 0.11, 16.3,   0, 50.0 },
+        { Waveform::sine,     Filter::filterBank,      true,  0.20, 13.0,   0, 45.0 },
+        { Waveform::sawtooth, Filter::doublePrecision, false, 0.09, 10.5,   0, 45.0 },
+        { Waveform::sawtooth, Filter::doublePrecision, true,  0.41, 10.5,   0, 45.0 },
+        { Waveform::sawtooth, Filter::singlePrecision, false, 0.09, 10.5,   0, 45.0 },
+        { Waveform::sawtooth, Filter::singlePrecision, true,  0.32, 10.5,   0, 45.0 },
+        { Waveform::sawtooth, Filter::filterBank,      false, 0.09, 10.5,   0, 45.0 },
+        { Waveform::sawtooth, Filter::filterBank,      true,  0.41, 10.5,   0, 45.0 },
+        { Waveform::plucked,  Filter::doublePrecision, false, 0.03,  8.8, 183, 40.0 },
+        { Waveform::plucked,  Filter::doublePrecision, true,  0.39,  9.6, 174, 40.0 },
+        { Waveform::plucked,  Filter::singlePrecision, false, 0.03,  8.8, 183, 40.0 },
+        { Waveform::plucked,  Filter::singlePrecision, true,  0.39,  9.6, 174, 40.0 },
+        { Waveform::plucked,  Filter::filterBank,      false, 0.03,  8.8, 183, 40.0 },
+        { Waveform::plucked,  Filter::filterBank,      true,  0.39,  9.6, 174, 40.0 },
+        { Waveform::noisy,    Filter::doublePrecision, false, 1.58, 12.0,   0, 50.0 },
+        { Waveform::noisy,    Filter::doublePrecision, true,  1.59, 12.4,   0, 50.0 },
+        { Waveform::noisy,    Filter::singlePrecision, false, 1.58, 12.0,   0, 50.0 },
+        { Waveform::noisy,    Filter::singlePrecision, true,  1.59, 12.4,   0, 50.0 },
+        { Waveform::noisy,    Filter::filterBank,      false, 1.58, 12.0,   0, 50.0 },
+        { Waveform::noisy,    Filter::filterBank,      true,  1.59, 12.4,   0, 50.0 },
+    };
+
+    struct FrameTolerance
+    {
+        double maxCents;
+        int mismatchedFrames;
+    };
+
+    // Every engine computes the same difference function up to float rounding, which can still move the threshold
+    // search onto the next lag of a shallow dip. The time domain earlyExit search computes the very same lags as full
+    // and has to match it exactly.
+    constexpr FrameTolerance defaultFrameTolerance { 0.5, 0 };
+    constexpr FrameTolerance exactFrameTolerance { 0.0, 0 };
+
+    // Configurations that stray further, each with its measured drift plus some headroom, for every band limit filter
+    struct FrameBaseline
+    {
+        Waveform waveform;
+        bool decimated;
+        Engine engine;
+        TauSearch search;
+        FrameTolerance tolerance;
+    };
+
+    constexpr FrameBaseline frameBaselines[] =
+    {
+        { Waveform::sawtooth, true,  Engine::timeDomain,  TauSearch::coarseToFine, { 4.5, 0 } },
+        { Waveform::sawtooth, true,  Engine::fft,         TauSearch::full,         { 4.5, 0 } },
+        { Waveform::sawtooth, true,  Engine::fft,         TauSearch::earlyExit,    { 4.5, 0 } },
+        { Waveform::sawtooth, true,  Engine::fft,         TauSearch::coarseToFine, { 4.5, 0 } },
+        { Waveform::sawtooth, true,  Engine::incremental, TauSearch::full,         { 4.5, 0 } },
+        { Waveform::sawtooth, true,  Engine::incremental, TauSearch::earlyExit,    { 4.5, 0 } },
+        { Waveform::sawtooth, true,  Engine::incremental, TauSearch::coarseToFine, { 4.5, 0 } },
+    };
+
+    // Strums in standard tuning, in tune and with every string off by a different amount
+    using Strum = std::array<float, GuitarPitchDetectionFX::numStrings>;
+
+    constexpr Strum strumStrings = { 82.41f, 110.0f, 146.83f, 196.0f, 246.94f, 329.63f };
+    constexpr Strum strumDetuneCents = { 17.2f, -12.0f, 6.0f, -9.0f, 14.0f, -4.0f };
+    constexpr float strumSampleRate = 48000.0f;
+    constexpr float strumSeconds = 1.5f;
+    constexpr float strumInternalRates[] = { 0.0f, 11025.0f, 8000.0f };
+
+    // results are only checked once the spectrum frame lies entirely inside the strum
+    constexpr float strumSettleSeconds = 0.4f;
+
+    // Largest error of any string with some headroom, every string must be found in every frame after settling.
+    // The B and high E sit on harmonics of the low strings, the sawtooth's full set of partials costs them the most.
+    struct StrumBaseline
+    {
+        Waveform waveform;
+        float internalRate;
+        bool detuned;
+        double maxCents;
+    };
+
+    constexpr StrumBaseline strumBaselines[] =
+    {
+        { Waveform::sawtooth, 0.0f,     false, 5.0 },
+        { Waveform::sawtooth, 11025.0f, false, 5.0 },
+        { Waveform::sawtooth, 8000.0f,  false, 9.0 },
+        { Waveform::sawtooth, 0.0f,     true,  6.5 },
+        { Waveform::sawtooth, 11025.0f, true,  6.5 },
+        { Waveform::sawtooth, 8000.0f,  true,  2.5 },
+        { Waveform::noisy,    0.0f,     false, 1.5 },
+        { Waveform::noisy,    11025.0f, false, 1.5 },
+        { Waveform::noisy,    8000.0f,  false, 1.0 },
+        { Waveform::noisy,    0.0f,     true,  1.5 },
+        { Waveform::noisy,    11025.0f, true,  1.5 },
+        { Waveform::noisy,    8000.0f,  true,  1.2 },
+    };
+
+    // Detectors that have to agree with the synchronous timeDomain/full detector with the same window, over every note
+    // at one host rate. Frames are compared once the signal frame lies entirely inside the note.
+    enum class Mode
+    {
+        analysisThread,
+        amortised,
+        fixedSize,
+        fixedSizeAnalysisThread
+    };
+
+    constexpr Mode modes[] = { Mode::analysisThread, Mode::amortised, Mode::fixedSize, Mode::fixedSizeAnalysisThread };
+    constexpr Waveform modeWaveforms[] = { Waveform::sine, Waveform::plucked };
+    constexpr float modeSampleRate = 48000.0f;
+    constexpr int modeHopSize = static_cast<int> (modeSampleRate * hopSeconds);
+    constexpr int modeWindowSize = 2048;
+    constexpr float modeSettleSeconds = 0.1f;
+
+    // a threaded detector that has not caught up with a block after this long counts as stalled
+    constexpr int maxWaitMs = 1000;
+
+    // The analysis thread and fixed storage only move where the work happens and must match exactly. Amortised skips
+    // the frames that arrive while one is in progress, the ones it does analyse must match too.
+    constexpr FrameTolerance modeFrameTolerance { 0.0, 0 };
+
+    // Polyphonic results against the monophonic rms over the same steady note, in dB
+    constexpr double polyphonicLevelToleranceDb = 0.2;
+
+    // Multi-channel detector against one mono detector per channel, only float rounding in the batched lag loop
+    constexpr FrameTolerance multiChannelTolerance { 0.1, 0 };
+
+    const char* getName (Mode mode) noexcept
+    {
+        switch (mode)
+        {
+            case Mode::analysisThread:          return "analysisThread";
+            case Mode::amortised:               return "amortised";
+            case Mode::fixedSize:               return "fixedSize";
+            case Mode::fixedSizeAnalysisThread: return "fixedSize/analysisThread";
+            default:                            return "";
+        }
+    }
+
+    const Baseline* findBaseline (Waveform waveform, Filter filter, bool decimated)
+    {
+        for (const auto& baseline : baselines)
+            if (baseline.waveform == waveform && baseline.filter == filter && baseline.decimated == decimated)
+                return &baseline;
+
+        return nullptr;
+    }
+
+    FrameTolerance findFrameTolerance (Waveform waveform, bool decimated, Engine engine, TauSearch search)
+    {
+        for (const auto& baseline : frameBaselines)
+            if (baseline.waveform == waveform && baseline.decimated == decimated && baseline.engine == engine && baseline.search == search)
+                return baseline.tolerance;
+
+        return engine == Engine::timeDomain && search == TauSearch::earlyExit ? exactFrameTolerance : defaultFrameTolerance;
+    }
+
+    const StrumBaseline* findStrumBaseline (Waveform waveform, float internalRate, bool detuned)
+    {
+        for (const auto& baseline : strumBaselines)
+            if (baseline.waveform == waveform && baseline.internalRate == internalRate && baseline.detuned == detuned)
+                return &baseline;
+
+        return nullptr;
+    }
+
+    double getCents (float pitch, float frequency) noexcept
+    {
+        return 1200.0 * std::log2 (static_cast<double> (pitch) / frequency);
+    }
+
+    using Frames = std::vector<GuitarPitchDetectionFX::PitchResult>;
+
+    // Every engine and search over the same note, results[c] holds the frames after the onset for engines[c / numSearches]
+    // with searches[c % numSearches], so results[0] is the timeDomain/full reference
+    std::array<Frames, numConfigs> runNote (Waveform waveform, Filter filter, bool decimated, float sampleRate, float frequency)
+    {
+        const int factor = decimated ? juce::jmax (1, static_cast<int> (sampleRate / decimatedRate)) : 1;
+        const float analysisRate = sampleRate / static_cast<float> (factor);
+
+        std::array<std::unique_ptr<GuitarPitchDetectionFX>, numConfigs> detectors;
+
+        for (int c = 0; c < numConfigs; ++c)
+        {
+            auto& fx = detectors[static_cast<size_t> (c)];
+            fx = std::make_unique<GuitarPitchDetectionFX>();
+            fx->setSampleRate (sampleRate);
+            fx->setDifferenceEngine (engines[c / numSearches]);
+            fx->setTauSearch (searches[c % numSearches]);
+            fx->setBandLimitFilter (filter);
+            fx->setInternalSampleRate (decimated ? decimatedRate : 0.0f);
+            fx->setHopSize (juce::jmax (1, static_cast<int> (analysisRate * hopSeconds)));
+            fx->setFrequencyRange (60.0f, 1100.0f);
+            fx->init();
+        }
+
+        auto signal = SignalGenerators::generate (waveform, frequency, sampleRate, onsetSeconds, noteSeconds);
+        std::array<Frames, numConfigs> results;
+        GuitarPitchDetectionFX::PitchResult result;
+
+        for (size_t start = 0; start < signal.size(); start += blockSize)
+        {
+            const int numSamples = static_cast<int> (juce::jmin<size_t> (blockSize, signal.size() - start));
+
+            for (size_t c = 0; c < detectors.size(); ++c)
+            {
+                detectors[c]->process (signal.data() + start, numSamples);
+
+                while (detectors[c]->popResult (result))
+                    if (result.time > onsetSeconds)
+                        results[c].push_back (result);
+            }
+        }
+
+        return results;
+    }
+
+    void configureModeDetector (GuitarPitchDetectionFX& fx, GuitarPitchDetectionFX::ThreadingMode threadingMode)
+    {
+        fx.setSampleRate (modeSampleRate);
+        fx.setThreadingMode (threadingMode);
+        fx.setHopSize (modeHopSize);
+        fx.setFrequencyRange (60.0f, 1100.0f);
+    }
+
+    // Feeds the signal block by block and collects the frames after the onset. With the analysis thread running every
+    // hop at the host rate queues one result, so it waits for each block's results before queueing the next one and
+    // neither queue can overflow.
+    Frames runDetector (GuitarPitchDetectionFX& fx, std::vector<float>& signal, bool threaded)
+    {
+        Frames results;
+        GuitarPitchDetectionFX::PitchResult result;
+        size_t numResults = 0;
+
+        for (size_t start = 0; start < signal.size(); start += blockSize)
+        {
+            const int numSamples = static_cast<int> (juce::jmin<size_t> (blockSize, signal.size() - start));
+            const size_t expectedResults = threaded ? (start + static_cast<size_t> (numSamples)) / modeHopSize : 0;
+
+            fx.process (signal.data() + start, numSamples);
+
+            for (int waited = 0;; ++waited)
+            {
+                while (fx.popResult (result))
+                {
+                    ++numResults;
+
+                    if (result.time > onsetSeconds)
+                        results.push_back (result);
+                }
+
+                if (numResults >= expectedResults || waited >= maxWaitMs)
+                    break;
+
+                std::this_thread::sleep_for (std::chrono::milliseconds (1));
+            }
+        }
+
+        return results;
+    }
+
+    Frames runMode (Mode mode, std::vector<float>& signal)
+    {
+        using ThreadingMode = GuitarPitchDetectionFX::ThreadingMode;
+
+        switch (mode)
+        {
+            case Mode::fixedSize:
+            {
+                auto fx = std::make_unique<FixedSizeGuitarPitchDetectionFX<modeWindowSize>>();
+                configureModeDetector (*fx, ThreadingMode::audioThread);
+                fx->init();
+                return runDetector (*fx, signal, false);
+            }
+
+            case Mode::fixedSizeAnalysisThread:
+            {
+                auto fx = std::make_unique<FixedSizeGuitarPitchDetectionFX<modeWindowSize, true>>();
+                configureModeDetector (*fx, ThreadingMode::analysisThread);
+                fx->init();
+                return runDetector (*fx, signal, true);
+            }
+
+            case Mode::analysisThread:
+            case Mode::amortised:
+            default:
+            {
+                const bool threaded = mode == Mode::analysisThread;
+                auto fx = std::make_unique<GuitarPitchDetectionFX>();
+                configureModeDetector (*fx, threaded ? ThreadingMode::analysisThread : ThreadingMode::amortised);
+                fx->init (modeWindowSize);
+                return runDetector (*fx, signal, threaded);
+            }
+        }
+    }
+
+    // Frames after the first lock count towards cent error and octave errors, frames with no pitch are left out
+    void addNoteStats (AccuracyStats& stats, const Frames& frames, float frequency)
+    {
+        bool locked = false;
+
+        for (const auto& frame : frames)
+        {
+            if (frame.pitch <= 0.0f)
+                continue;
+
+            const double cents = getCents (frame.pitch, frequency);
+
+            if (! locked)
+            {
+                if (std::abs (cents) >= lockCents)
+                    continue;
+
+                locked = true;
+                stats.maxLatencyMs = juce::jmax (stats.maxLatencyMs, (frame.time - onsetSeconds) * 1000.0);
+            }
+
+            ++stats.numFrames;
+
+            if (std::abs (cents) > 600.0)
+            {
+                ++stats.octaveErrors;
+                continue;
+            }
+
+            stats.meanCents += std::abs (cents);
+            stats.maxCents = juce::jmax (stats.maxCents, std::abs (cents));
+        }
+
+        if (! locked)
+            ++stats.missedNotes;
+    }
+
+    void addFrameStats (FrameStats& stats, const Frames& frames, const Frames& reference)
+    {
+        stats.mismatchedFrames += std::abs (static_cast<int> (frames.size()) - static_cast<int> (reference.size()));
+
+        for (size_t i = 0; i < juce::jmin (frames.size(), reference.size()); ++i)
+        {
+            const float pitch = frames[i].pitch;
+            const float referencePitch = reference[i].pitch;
+
+            if (pitch <= 0.0f && referencePitch <= 0.0f)
+                continue;
+
+            const double cents = pitch > 0.0f && referencePitch > 0.0f ? std::abs (getCents (pitch, referencePitch)) : 1200.0;
+
+            if (cents > 600.0)
+                ++stats.mismatchedFrames;
+            else
+                stats.maxCents = juce::jmax (stats.maxCents, cents);
+        }
+    }
+
+    // Like addFrameStats for a detector that skips frames, each frame is compared with the reference frame of the
+    // same time and frames the reference never produced count as mismatched
+    void addMatchedFrameStats (FrameStats& stats, const Frames& frames, const Frames& reference)
+    {
+        Frames matchedFrames, matchedReference;
+        size_t r = 0;
+
+        for (const auto& frame : frames)
+        {
+            while (r < reference.size() && reference[r].time < frame.time)
+                ++r;
+
+            if (r == reference.size() || reference[r].time != frame.time)
+            {
+                ++stats.mismatchedFrames;
+                continue;
+            }
+
+            matchedFrames.push_back (frame);
+            matchedReference.push_back (reference[r]);
+        }
+
+        addFrameStats (stats, matchedFrames, matchedReference);
+    }
+
+    Frames getSettledFrames (const Frames& frames, float settleSeconds)
+    {
+        Frames settled;
+
+        for (const auto& frame : frames)
+            if (frame.time >= onsetSeconds + settleSeconds)
+                settled.push_back (frame);
+
+        return settled;
+    }
+
+    // Max error per string over the frames after settling, missedFrames counts frames where any string was not found
+    // or the result carried no level
+    void measureStrum (Strum& maxCents, int& missedFrames, Waveform waveform, float internalRate, bool detuned)
+    {
+        Strum frequencies;
+
+        for (size_t s = 0; s < frequencies.size(); ++s)
+            frequencies[s] = strumStrings[s] * std::exp2 ((detuned ? strumDetuneCents[s] : 0.0f) / 1200.0f);
+
+        auto fx = std::make_unique<GuitarPitchDetectionFX>();
+        fx->setSampleRate (strumSampleRate);
+        fx->setInternalSampleRate (internalRate);
+        fx->setAnalysisMode (GuitarPitchDetectionFX::AnalysisMode::polyphonic);
+        fx->setTargetNotes (strumStrings);
+        fx->setFrequencyRange (70.0f, 1000.0f);
+        fx->init();
+
+        auto signal = SignalGenerators::generateStrum (waveform, frequencies, strumSampleRate, onsetSeconds, strumSeconds);
+        const auto settled = static_cast<size_t> ((onsetSeconds + strumSettleSeconds) * strumSampleRate);
+        GuitarPitchDetectionFX::PitchResult result;
+
+        maxCents.fill (0.0f);
+        missedFrames = 0;
+
+        for (size_t start = 0; start < signal.size(); start += blockSize)
+        {
+            fx->process (signal.data() + start, static_cast<int> (juce::jmin<size_t> (blockSize, signal.size() - start)));
+
+            // the string results are replaced every frame, one check per frame that completed in this block
+            bool newFrame = false;
+
+            while (fx->popResult (result))
+                newFrame = true;
+
+            if (! newFrame || start < settled)
+                continue;
+
+            bool missed = result.rms <= 0.0f;
+
+            for (size_t s = 0; s < frequencies.size(); ++s)
+            {
+                const auto stringResult = fx->getStringResult (static_cast<int> (s));
+
+                if (stringResult.pitch <= 0.0f)
+                {
+                    missed = true;
+                    continue;
+                }
+
+                maxCents[s] = juce::jmax (maxCents[s], static_cast<float> (std::abs (getCents (stringResult.pitch, frequencies[s]))));
+            }
+
+            missedFrames += missed ? 1 : 0;
+        }
+    }
+
+    // Runs every engine and search for one signal, filter and front end, returns the number of failed checks
+    int testSignal (Waveform waveform, Filter filter, bool decimated)
+    {
+        std::array<AccuracyStats, numConfigs> stats {};
+        std::array<FrameStats, numConfigs> frameStats {};
+
+        // notes where a search made a different number of octave errors than the full search with the same engine
+        std::array<int, numConfigs> octaveMismatches {};
+
+        for (const auto sampleRate : sampleRates)
+        {
+            for (const auto frequency : notes)
+            {
+                const auto results = runNote (waveform, filter, decimated, sampleRate, frequency);
+
+                std::array<int, numConfigs> noteOctaveErrors {};
+
+                for (size_t c = 0; c < results.size(); ++c)
+                {
+                    const int octaveErrors = stats[c].octaveErrors;
+                    addNoteStats (stats[c], results[c], frequency);
+                    addFrameStats (frameStats[c], results[c], results[0]);
+                    noteOctaveErrors[c] = stats[c].octaveErrors - octaveErrors;
+                }
+
+                for (size_t c = 0; c < results.size(); ++c)
+                    if (noteOctaveErrors[c] != noteOctaveErrors[c / numSearches * numSearches])
+                        ++octaveMismatches[c];
+            }
+        }
+
+        int failures = 0;
+
+        for (int c = 0; c < numConfigs; ++c)
+        {
+            const auto engine = engines[c / numSearches];
+            const auto search = searches[c % numSearches];
+            auto& s = stats[static_cast<size_t> (c)];
+            const auto& f = frameStats[static_cast<size_t> (c)];
+
+            const int numInTune = s.numFrames - s.octaveErrors;
+            s.meanCents = numInTune > 0 ? s.meanCents / numInTune : 0.0;
+
+            bool failed = s.missedNotes > 0 || octaveMismatches[static_cast<size_t> (c)] > 0;
+
+            if (c == 0)
+            {
+                const auto* baseline = findBaseline (waveform, filter, decimated);
+
+                failed = failed || baseline == nullptr
+                      || s.meanCents > baseline->meanCents
+                      || s.maxCents > baseline->maxCents
+                      || s.octaveErrors > baseline->octaveErrors
+                      || s.maxLatencyMs > baseline->maxLatencyMs;
+            }
+            else
+            {
+                const auto tolerance = findFrameTolerance (waveform, decimated, engine, search);
+
+                failed = failed
+                      || f.maxCents > tolerance.maxCents
+                      || f.mismatchedFrames > tolerance.mismatchedFrames;
+            }
+
+            failures += failed ? 1 : 0;
+
+            std::cout << (failed ? "FAIL " : "ok   ")
+                      << SignalGenerators::getName (waveform) << ' ' << getName (filter) << (decimated ? " decimated " : " host ")
+                      << getName (engine) << '/' << getName (search)
+                      << " cents_mean=" << s.meanCents << " cents_max=" << s.maxCents
+                      << " octave_errors=" << s.octaveErrors << '/' << s.numFrames
+                      << " latency_ms=" << s.maxLatencyMs << " missed=" << s.missedNotes
+                      << " octave_mismatch=" << octaveMismatches[static_cast<size_t> (c)]
+                      << " frame_cents=" << f.maxCents << " frame_mismatch=" << f.mismatchedFrames << std::endl;
+        }
+
+        return failures;
+    }
+
+    int testStrum (Waveform waveform, float internalRate, bool detuned)
+    {
+        Strum maxCents {};
+        int missedFrames = 0;
+        measureStrum (maxCents, missedFrames, waveform, internalRate, detuned);
+
+        const auto* baseline = findStrumBaseline (waveform, internalRate, detuned);
+        const bool failed = missedFrames > 0 || baseline == nullptr
+                         || std::any_of (maxCents.begin(), maxCents.end(), [baseline] (float cents) { return cents > baseline->maxCents; });
+
+        std::cout << (failed ? "FAIL " : "ok   ") << "strum " << SignalGenerators::getName (waveform)
+                  << " internal=" << internalRate << (detuned ? " detuned" : " in tune") << " missed=" << missedFrames;
+
+        for (size_t s = 0; s < maxCents.size(); ++s)
+            std::cout << " cents_s" << s << '=' << maxCents[s];
+
+        std::cout << std::endl;
+
+        return failed ? 1 : 0;
+    }
+
+    int testMode (Mode mode, Waveform waveform)
+    {
+        AccuracyStats stats, referenceStats;
+        FrameStats frameStats;
+
+        for (const auto frequency : notes)
+        {
+            auto signal = SignalGenerators::generate (waveform, frequency, modeSampleRate, onsetSeconds, noteSeconds);
+
+            auto reference = std::make_unique<GuitarPitchDetectionFX>();
+            configureModeDetector (*reference, GuitarPitchDetectionFX::ThreadingMode::audioThread);
+            reference->init (modeWindowSize);
+
+            const auto referenceFrames = getSettledFrames (runDetector (*reference, signal, false), modeSettleSeconds);
+            const auto frames = getSettledFrames (runMode (mode, signal), modeSettleSeconds);
+
+            addNoteStats (stats, frames, frequency);
+            addNoteStats (referenceStats, referenceFrames, frequency);
+
+            if (mode == Mode::amortised)
+                addMatchedFrameStats (frameStats, frames, referenceFrames);
+            else
+                addFrameStats (frameStats, frames, referenceFrames);
+        }
+
+        const bool failed = stats.missedNotes != referenceStats.missedNotes
+                         || frameStats.maxCents > modeFrameTolerance.maxCents
+                         || frameStats.mismatchedFrames > modeFrameTolerance.mismatchedFrames;
+
+        std::cout << (failed ? "FAIL " : "ok   ") << "mode " << getName (mode) << ' ' << SignalGenerators::getName (waveform)
+                  << " frames=" << stats.numFrames << " missed=" << stats.missedNotes << '/' << referenceStats.missedNotes
+                  << " frame_cents=" << frameStats.maxCents << " frame_mismatch=" << frameStats.mismatchedFrames << std::endl;
+
+        return failed ? 1 : 0;
+    }
+
+    // The rms of a polyphonic result is the level of its spectrum frame, on a steady note it has to match the level
+    // the monophonic detector reports for its shorter frame
+    int testPolyphonicLevel (float internalRate)
+    {
+        std::array<Frames, 2> results;
+
+        for (size_t m = 0; m < results.size(); ++m)
+        {
+            auto fx = std::make_unique<GuitarPitchDetectionFX>();
+            fx->setSampleRate (strumSampleRate);
+            fx->setInternalSampleRate (internalRate);
+            fx->setAnalysisMode (m == 0 ? GuitarPitchDetectionFX::AnalysisMode::monophonic : GuitarPitchDetectionFX::AnalysisMode::polyphonic);
+            fx->setTargetNotes (strumStrings);
+            fx->setFrequencyRange (70.0f, 1000.0f);
+            fx->init();
+
+            auto signal = SignalGenerators::generate (Waveform::sine, strumStrings[1], strumSampleRate, onsetSeconds, noteSeconds);
+            results[m] = getSettledFrames (runDetector (*fx, signal, false), strumSettleSeconds);
+        }
+
+        double monophonicRms = 0.0;
+
+        for (const auto& frame : results[0])
+            monophonicRms += frame.rms / static_cast<double> (results[0].size());
+
+        double maxErrorDb = results[1].empty() || monophonicRms <= 0.0 ? 100.0 : 0.0;
+
+        for (const auto& frame : results[1])
+            maxErrorDb = juce::jmax (maxErrorDb, frame.rms > 0.0f ? std::abs (20.0 * std::log10 (frame.rms / monophonicRms)) : 100.0);
+
+        const bool failed = maxErrorDb > polyphonicLevelToleranceDb;
+
+        std::cout << (failed ? "FAIL " : "ok   ") << "polyphonic rms internal=" << internalRate << " frames=" << results[1].size()
+                  << " mono_rms=" << monophonicRms << " error_db=" << maxErrorDb << std::endl;
+
+        return failed ? 1 : 0;
+    }
+
+    // One string per channel against a mono detector per string with the same window and hop, compared after
+    // every block once the frames lie inside the note
+    int testMultiChannel (Waveform waveform)
+    {
+        constexpr int numChannels = GuitarPitchDetectionFX::numStrings;
+
+        auto multiChannel = std::make_unique<MultiChannelPitchDetectionFX>();
+        multiChannel->setSampleRate (modeSampleRate);
+        multiChannel->setHopSize (modeHopSize);
+        multiChannel->setFrequencyRange (70.0f, 1000.0f);
+        multiChannel->init();
+
+        std::array<std::unique_ptr<GuitarPitchDetectionFX>, numChannels> references;
+        std::array<std::vector<float>, numChannels> signals;
+        std::array<const float*, numChannels> channels {};
+
+        for (size_t c = 0; c < references.size(); ++c)
+        {
+            auto& fx = references[c];
+            fx = std::make_unique<GuitarPitchDetectionFX>();
+            fx->setSampleRate (modeSampleRate);
+            fx->setHopSize (modeHopSize);
+            fx->setFrequencyRange (70.0f, 1000.0f);
+            fx->setSensitivity (0.0f);
+            fx->init();
+
+            signals[c] = SignalGenerators::generate (waveform, strumStrings[c], modeSampleRate, onsetSeconds, noteSeconds);
+        }
+
+        const auto settled = static_cast<size_t> ((onsetSeconds + modeSettleSeconds) * modeSampleRate);
+        FrameStats stats;
+
+        for (size_t start = 0; start < signals[0].size(); start += blockSize)
+        {
+            const int numSamples = static_cast<int> (juce::jmin<size_t> (blockSize, signals[0].size() - start));
+
+            for (size_t c = 0; c < signals.size(); ++c)
+            {
+                channels[c] = signals[c].data() + start;
+                references[c]->process (signals[c].data() + start, numSamples);
+            }
+
+            multiChannel->process (channels.data(), numChannels, numSamples);
+
+            if (start < settled)
+                continue;
+
+            for (size_t c = 0; c < references.size(); ++c)
+            {
+                const float pitch = multiChannel->getPitch (static_cast<int> (c));
+                const float referencePitch = references[c]->getPitch();
+
+                if (pitch > 0.0f && referencePitch > 0.0f)
+                    stats.maxCents = juce::jmax (stats.maxCents, std::abs (getCents (pitch, referencePitch)));
+                else if ((pitch > 0.0f) != (referencePitch > 0.0f))
+                    ++stats.mismatchedFrames;
+            }
+        }
+
+        const bool failed = stats.maxCents > multiChannelTolerance.maxCents || stats.mismatchedFrames > multiChannelTolerance.mismatchedFrames;
+
+        std::cout << (failed ? "FAIL " : "ok   ") << "multichannel " << SignalGenerators::getName (waveform)
+                  << " frame_cents=" << stats.maxCents << " frame_mismatch=" << stats.mismatchedFrames << std::endl;
+
+        return failed ? 1 : 0;
+    }
+}
+
+int main()
+{
+    int failures = 0;
+
+    for (int waveform = 0; waveform < static_cast<int> (Waveform::numWaveforms); ++waveform)
+        for (const auto filter : filters)
+            for (int decimated = 0; decimated < 2; ++decimated)
+                failures += testSignal (static_cast<Waveform> (waveform), filter, decimated != 0);
+
+    for (const auto waveform : { Waveform::sawtooth, Waveform::noisy })
+        for (const auto internalRate : strumInternalRates)
+            for (int detuned = 0; detuned < 2; ++detuned)
+                failures += testStrum (waveform, internalRate, detuned != 0);
+
+    for (const auto mode : modes)
+        for (const auto waveform : modeWaveforms)
+            failures += testMode (mode, waveform);
+
+    for (const auto internalRate : strumInternalRates)
+        failures += testPolyphonicLevel (internalRate);
+
+    for (const auto waveform : modeWaveforms)
+        failures += testMultiChannel (waveform);
+
+    std::cout << failures << " configurations exceeded their baseline" << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include <JuceHeader.h>
+#include <random>
+
+// Synthetic notes at an exact frequency for the accuracy tests. Every signal starts with onsetSeconds of
+// silence so detection latency can be measured from the onset, and is seeded so runs are repeatable.
+
+namespace SignalGenerators
+{
+    enum class Waveform
+    {
+        sine,
+        sawtooth,
+        plucked,
+        noisy,
+        numWaveforms
+    };
+
+    inline const char* getName (Waveform waveform) noexcept
+    {
+        switch (waveform)
+        {
+            case Waveform::sine:     return "sine";
+            case Waveform::sawtooth: return "sawtooth";
+            case Waveform::plucked:  return "plucked";
+            case Waveform::noisy:    return "noisy";
+            default:                 return "";
+        }
+    }
+
+    // Harmonics at 1 / k up to a quarter of the sample rate or 5 kHz, far past the detector's band limit
+    inline void addSawtooth (std::vector<float>& signal, size_t start, float frequency, float sampleRate)
+    {
+        const int numHarmonics = juce::jmax (1, static_cast<int> (juce::jmin (sampleRate * 0.25f, 5000.0f) / frequency));
+        const double phaseStep = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+
+        for (size_t i = start; i < signal.size(); ++i)
+        {
+            const double phase = phaseStep * static_cast<double> (i - start);
+            double sample = 0.0;
+
+            for (int k = 1; k <= numHarmonics; ++k)
+                sample += std::sin (phase * k) / k;
+
+            signal[i] = static_cast<float> (0.3 * sample);
+        }
+    }
+
+    // Karplus-Strong with a first order allpass for the fractional part of the loop delay so the pitch is exact
+    inline void addPlucked (std::vector<float>& signal, size_t start, float frequency, float sampleRate, std::mt19937& rng)
+    {
+        constexpr float loopGain = 0.996f;
+
+        // the two point average in the loop adds half a sample of delay
+        const double period = sampleRate / static_cast<double> (frequency) - 0.5;
+        auto delay = static_cast<size_t> (period);
+        double fraction = period - static_cast<double> (delay);
+
+        // keep the allpass delay away from 0 where its coefficient approaches 1
+        if (fraction < 0.1)
+        {
+            fraction += 1.0;
+            delay -= 1;
+        }
+
+        const auto allpass = static_cast<float> ((1.0 - fraction) / (1.0 + fraction));
+
+        std::uniform_real_distribution<float> excitation (-0.5f, 0.5f);
+        std::vector<float> line (delay);
+
+        for (auto& sample : line)
+            sample = excitation (rng);
+
+        size_t position = 0;
+        float previous = 0.0f;
+        float allpassIn = 0.0f;
+        float allpassOut = 0.0f;
+
+        for (size_t i = start; i < signal.size(); ++i)
+        {
+            const float current = line[position];
+            const float averaged = loopGain * 0.5f * (current + previous);
+            previous = current;
+
+            allpassOut = allpass * averaged + allpassIn - allpass * allpassOut;
+            allpassIn = averaged;
+
+            line[position] = allpassOut;
+            position = (position + 1) % delay;
+
+            signal[i] = current;
+        }
+    }
+
+    inline std::vector<float> generate (Waveform waveform, float frequency, float sampleRate,
+                                        float onsetSeconds, float noteSeconds, unsigned int seed = 1234)
+    {
+        const auto start = static_cast<size_t> (onsetSeconds * sampleRate);
+        std::vector<float> signal (start + static_cast<size_t> (noteSeconds * sampleRate), 0.0f);
+        std::mt19937 rng (seed);
+
+        if (waveform == Waveform::sawtooth)
+        {
+            addSawtooth (signal, start, frequency, sampleRate);
+        }
+        else if (waveform == Waveform::plucked)
+        {
+            addPlucked (signal, start, frequency, sampleRate, rng);
+        }
+        else
+        {
+            const double phaseStep = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+
+            for (size_t i = start; i < signal.size(); ++i)
+            {
+                const double phase = phaseStep * static_cast<double> (i - start);
+                const double sample = waveform == Waveform::noisy ? 0.3 * std::sin (phase) + 0.15 * std::sin (2.0 * phase) + 0.08 * std::sin (3.0 * phase)
+                                                                  : 0.5 * std::sin (phase);
+
+                signal[i] = static_cast<float> (sample);
+            }
+
+            // white noise about 10 dB under the note
+            if (waveform == Waveform::noisy)
+            {
+                std::normal_distribution<float> noise (0.0f, 0.077f);
+
+                for (size_t i = start; i < signal.size(); ++i)
+                    signal[i] += noise (rng);
+            }
+        }
+
+        return signal;
+    }
+
+    // Every string of a strum at once, each note seeded differently and scaled so six of them stay within +-1
+    template <size_t numStrings>
+    std::vector<float> generateStrum (Waveform waveform, const std::array<float, numStrings>& frequencies, float sampleRate,
+                                      float onsetSeconds, float noteSeconds, unsigned int seed = 1234)
+    {
+        std::vector<float> strum;
+
+        for (size_t s = 0; s < numStrings; ++s)
+        {
+            const auto note = generate (waveform, frequencies[s], sampleRate, onsetSeconds, noteSeconds, seed + static_cast<unsigned int> (s));
+            strum.resize (note.size(), 0.0f);
+
+            for (size_t i = 0; i < note.size(); ++i)
+                strum[i] += 0.3f * note[i];
+        }
+
+        return strum;
+    }
+}
@@ -0,0 +1,303 @@
+#include <JuceHeader.h>
+#include "GuitarPitchDetectionFX.h"
+
+// guitar-tuner-analyze - runs recorded takes through GuitarPitchDetectionFX outside a plugin host and writes
+// every frame's result next to the input, or into --output. Files are spread over a thread pool, one job per file.
+//
+// usage: guitar-tuner-analyze [--format=csv|binary] [--output=dir] [--jobs=n] [--hop=samples]
+//                             [--internal-rate=hz] [--engine=time|fft|incremental] [--sensitivity=level]
+//                             files or folders...
+//
+// --sensitivity is the plugin's sensitivity_level setting, frames the level gate skips are written with pitch -1.
+
+namespace
+{
+    using Engine = GuitarPitchDetectionFX::DifferenceEngine;
+
+    constexpr int maxBlockSize = 2048;
+    constexpr const char* audioFilePatterns = "*.wav;*.flac;*.aif;*.aiff";
+
+    enum class OutputFormat
+    {
+        csv,
+        binary
+    };
+
+    struct AnalysisSettings
+    {
+        OutputFormat format = OutputFormat::csv;
+        juce::File outputDirectory;
+        int hopSize = 512;
+        float internalSampleRate = 0.0f;
+        Engine engine = Engine::fft;
+        float sensitivity = 0.0f;
+    };
+
+    // Binary layout, little endian - "GTPA", int32 version, float64 sample rate, then per frame
+    // uint64 frame, float64 time, float32 pitch, float32 aperiodicity, float32 rms
+    class ResultWriter
+    {
+    public:
+        ResultWriter (juce::OutputStream& stream, OutputFormat outputFormat, double sampleRate)
+            : output (stream), format (outputFormat)
+        {
+            if (format == OutputFormat::csv)
+            {
+                output.writeText ("frame,time,pitch,aperiodicity,rms\n", false, false, nullptr);
+                return;
+            }
+
+            output.write ("GTPA", 4);
+            output.writeInt (1);
+            output.writeDouble (sampleRate);
+        }
+
+        void write (const GuitarPitchDetectionFX::PitchResult& result)
+        {
+            if (format == OutputFormat::binary)
+            {
+                output.writeInt64 (static_cast<juce::int64> (result.frame));
+                output.writeDouble (result.time);
+                output.writeFloat (result.pitch);
+                output.writeFloat (result.aperiodicity);
+                output.writeFloat (result.rms);
+                return;
+            }
+
+            char line[128];
+            const int length = snprintf (line, sizeof (line), "%llu,%.6f,%.4f,%.5f,%.6f\n",
+                                         static_cast<unsigned long long> (result.frame), result.time,
+                                         result.pitch, result.aperiodicity, result.rms);
+
+            output.write (line, static_cast<size_t> (length));
+        }
+
+    private:
+        juce::OutputStream& output;
+        OutputFormat format;
+    };
+
+    // WAV and AIFF are memory mapped, anything else is streamed
+    std::unique_ptr<juce::AudioFormatReader> createReader (juce::AudioFormatManager& formats, const juce::File& file)
+    {
+        if (auto* format = formats.findFormatForFileExtension (file.getFileExtension()))
+        {
+            std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped (format->createMemoryMappedReader (file));
+
+            if (mapped != nullptr && mapped->mapEntireFile())
+                return mapped;
+        }
+
+        return std::unique_ptr<juce::AudioFormatReader> (formats.createReaderFor (file));
+    }
+
+    juce::File getOutputFile (const juce::File& input, const AnalysisSettings& settings)
+    {
+        const auto directory = settings.outputDirectory == juce::File() ? input.getParentDirectory() : settings.outputDirectory;
+        const auto extension = settings.format == OutputFormat::csv ? ".pitch.csv" : ".pitch.bin";
+
+        return directory.getChildFile (input.getFileNameWithoutExtension() + extension);
+    }
+
+    // Runs the detector over the whole file, false if a block could not be read or the stream failed
+    bool writeResults (juce::AudioFormatReader& reader, juce::OutputStream& stream, const AnalysisSettings& settings)
+    {
+        auto detector = std::make_unique<GuitarPitchDetectionFX>();
+        detector->setSampleRate (static_cast<float> (reader.sampleRate));
+        detector->setDifferenceEngine (settings.engine);
+        detector->setInternalSampleRate (settings.internalSampleRate);
+        detector->setHopSize (settings.hopSize);
+        detector->setSensitivity (settings.sensitivity);
+        detector->init();
+
+        ResultWriter writer (stream, settings.format, reader.sampleRate);
+
+        // at most 32 frames per block, well inside the detector's result queue
+        const int blockSize = juce::jlimit (1, maxBlockSize, settings.hopSize * 32);
+        const auto numChannels = static_cast<int> (reader.numChannels);
+        juce::AudioBuffer<float> block (numChannels, blockSize);
+        GuitarPitchDetectionFX::PitchResult result;
+
+        for (juce::int64 position = 0; position < reader.lengthInSamples; position += blockSize)
+        {
+            const auto numSamples = static_cast<int> (juce::jmin<juce::int64> (blockSize, reader.lengthInSamples - position));
+
+            if (! reader.read (&block, 0, numSamples, position, true, true))
+                return false;
+
+            // mono sum, the detector only takes one channel
+            for (int channel = 1; channel < numChannels; ++channel)
+                block.addFrom (0, 0, block, channel, 0, numSamples);
+
+            if (numChannels > 1)
+                block.applyGain (0, 0, numSamples, 1.0f / static_cast<float> (numChannels));
+
+            detector->process (block.getWritePointer (0), numSamples);
+
+            while (detector->popResult (result))
+                writer.write (result);
+        }
+
+        stream.flush();
+
+        return ! stream.getStatus().failed();
+    }
+
+    // Returns the seconds of audio analysed, or a negative value if the file could not be read or written.
+    // Results go to a temporary file that only replaces the output once the whole file has been analysed,
+    // so a failed read never leaves a partial output behind
+    double analyseFile (const juce::File& input, const AnalysisSettings& settings)
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        const auto reader = createReader (formats, input);
+
+        if (reader == nullptr || reader->lengthInSamples <= 0)
+            return -1.0;
+
+        const juce::TemporaryFile temporary (getOutputFile (input, settings));
+
+        {
+            juce::FileOutputStream stream (temporary.getFile(), 1 << 16);
+
+            if (stream.failedToOpen() || ! writeResults (*reader, stream, settings))
+                return -1.0;
+        }
+
+        if (! temporary.overwriteTargetFileWithTemporary())
+            return -1.0;
+
+        return static_cast<double> (reader->lengthInSamples) / reader->sampleRate;
+    }
+
+    juce::Array<juce::File> collectInputFiles (const juce::ArgumentList& args)
+    {
+        juce::Array<juce::File> files;
+
+        for (const auto& arg : args.arguments)
+        {
+            if (arg.isOption())
+                continue;
+
+            const auto file = arg.resolveAsFile();
+
+            if (file.isDirectory())
+                files.addArray (file.findChildFiles (juce::File::findFiles, true, audioFilePatterns));
+            else if (file.existsAsFile())
+                files.add (file);
+            else
+                std::cerr << "skipping " << arg.text << ", no such file" << std::endl;
+        }
+
+        return files;
+    }
+
+    bool parseSettings (const juce::ArgumentList& args, AnalysisSettings& settings)
+    {
+        const auto format = args.getValueForOption ("--format");
+
+        if (format.isNotEmpty() && format != "csv" && format != "binary")
+            return false;
+
+        settings.format = format == "binary" ? OutputFormat::binary : OutputFormat::csv;
+
+        const auto engine = args.getValueForOption ("--engine");
+
+        if (engine == "time")
+            settings.engine = Engine::timeDomain;
+        else if (engine == "incremental")
+            settings.engine = Engine::incremental;
+        else if (engine.isNotEmpty() && engine != "fft")
+            return false;
+
+        if (args.containsOption ("--output"))
+        {
+            settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--output"));
+
+            if (! settings.outputDirectory.isDirectory())
+                return false;
+        }
+
+        if (args.containsOption ("--hop"))
+            settings.hopSize = args.getValueForOption ("--hop").getIntValue();
+
+        if (args.containsOption ("--internal-rate"))
+            settings.internalSampleRate = args.getValueForOption ("--internal-rate").getFloatValue();
+
+        if (args.containsOption ("--sensitivity"))
+            settings.sensitivity = args.getValueForOption ("--sensitivity").getFloatValue();
+
+        return settings.hopSize > 0 && settings.internalSampleRate >= 0.0f
+            && settings.sensitivity >= 0.0f && settings.sensitivity <= 1.0f;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    const juce::ArgumentList args (argc, argv);
+    AnalysisSettings settings;
+
+    if (! parseSettings (args, settings))
+    {
+        std::cerr << "usage: guitar-tuner-analyze [--format=csv|binary] [--output=dir] [--jobs=n] [--hop=samples]\n"
+                     "                            [--internal-rate=hz] [--engine=time|fft|incremental] [--sensitivity=level]\n"
+                     "                            files or folders..." << std::endl;
+        return 1;
+    }
+
+    const auto files = collectInputFiles (args);
+
+    if (files.isEmpty())
+    {
+        std::cerr << "no audio files to analyse" << std::endl;
+        return 1;
+    }
+
+    const int numJobs = args.containsOption ("--jobs") ? juce::jmax (1, args.getValueForOption ("--jobs").getIntValue())
+                                                       : juce::SystemStats::getNumCpus();
+
+    std::atomic<int> failedFiles { 0 };
+    std::atomic<int> remainingFiles { files.size() };
+    std::atomic<juce::int64> analysedMicroseconds { 0 };
+    juce::WaitableEvent finished;
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    {
+        // idle workers take the next file from the pool's queue, so long and short takes balance out on their own
+        juce::ThreadPool pool (numJobs);
+
+        for (const auto& file : files)
+        {
+            pool.addJob ([&, file]
+            {
+                const double seconds = analyseFile (file, settings);
+
+                if (seconds < 0.0)
+                {
+                    std::cerr << "failed to analyse " << file.getFullPathName() << std::endl;
+                    failedFiles.fetch_add (1);
+                }
+                else
+                {
+                    analysedMicroseconds.fetch_add (static_cast<juce::int64> (seconds * 1.0e6));
+                }
+
+                if (remainingFiles.fetch_sub (1) == 1)
+                    finished.signal();
+            });
+        }
+
+        finished.wait();
+    }
+
+    const double wallMinutes = (juce::Time::getMillisecondCounterHiRes() - startTime) / 60000.0;
+    const double audioHours = static_cast<double> (analysedMicroseconds.load()) / 3.6e9;
+
+    std::cout << files.size() - failedFiles.load() << " of " << files.size() << " files, "
+              << audioHours << " audio hours in " << wallMinutes << " minutes, "
+              << (wallMinutes > 0.0 ? audioHours / wallMinutes : 0.0) << " audio hours per minute" << std::endl;
+
+    return failedFiles.load() == 0 ? 0 : 2;
+}